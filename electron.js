@@ -167,7 +167,8 @@ ipcMain.handle('start-mining', async (event, config) => {
                 '--host', host,
                 '--port', port,
                 '--user', walletAddr,
-                '--threads', config?.mining?.threads || '2'
+                '--threads', config?.mining?.threads || '2',
+                '--intensity', String(config?.mining?.intensity ?? 1)
             ]);
         } else {
             const rpcServer = 'localhost:16110';
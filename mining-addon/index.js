@@ -34,6 +34,29 @@ module.exports = {
         });
     },
 
+    setThreads: (threads) => {
+        return new Promise((resolve, reject) => {
+            try {
+                const result = miningAddon.setThreads(threads);
+                resolve(result);
+            } catch (error) {
+                reject(error);
+            }
+        });
+    },
+
+    // Chrome trace JSON of recent pipeline events; pass a path to write a file
+    dumpTrace: (path) => {
+        return new Promise((resolve, reject) => {
+            try {
+                const result = path ? miningAddon.dumpTrace(path) : miningAddon.dumpTrace();
+                resolve(result);
+            } catch (error) {
+                reject(error);
+            }
+        });
+    },
+
     on: (event, callback) => {
         // TODO: Implement event emitters
         console.log('Event listener:', event);
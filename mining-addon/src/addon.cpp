@@ -1,6 +1,8 @@
 #include <napi.h>
 #include "miner.h"
 #include "stratum.h"
+#include "trace.h"
+#include "log.h"
 #include <memory>
 #include <thread>
 #include <iostream>
@@ -12,7 +14,6 @@ using namespace Napi;
 std::unique_ptr<kuzadesign::Miner> globalMiner;
 std::unique_ptr<kuzadesign::stratum::Client> globalClient;
 std::thread clientThread;
-bool clientRunning = false;
 
 // Helper to parse "host:port" or "stratum+tcp://host:port"
 void parsePoolUrl(const std::string& url, std::string& host, int& port) {
@@ -48,14 +49,44 @@ Value StartMining(const CallbackInfo& info) {
     std::string walletAddr = config.Get("wallet").As<Object>().Get("address").As<String>().Utf8Value();
     int threads = config.Get("mining").As<Object>().Get("threads").As<Number>().Int32Value();
     double intensity = config.Get("mining").As<Object>().Get("intensity").As<Number>().FloatValue();
+
+    kuzadesign::PlacementPolicy placement = kuzadesign::PlacementPolicy::None;
+    Object miningOpts = config.Get("mining").As<Object>();
+    if (miningOpts.Has("placement") && miningOpts.Get("placement").IsString()) {
+        kuzadesign::parsePlacementPolicy(miningOpts.Get("placement").As<String>().Utf8Value(), placement);
+    }
+    bool autotune = miningOpts.Has("autotune") && miningOpts.Get("autotune").ToBoolean().Value();
+    bool efficiency = miningOpts.Has("efficiency") && miningOpts.Get("efficiency").ToBoolean().Value();
+    kuzadesign::SchedulingClass scheduling = kuzadesign::SchedulingClass::Normal;
+    if (miningOpts.Has("scheduling") && miningOpts.Get("scheduling").IsString()) {
+        kuzadesign::parseSchedulingClass(miningOpts.Get("scheduling").As<String>().Utf8Value(), scheduling);
+    }
+    bool yieldToForeground = miningOpts.Has("yieldToForeground") &&
+                             miningOpts.Get("yieldToForeground").ToBoolean().Value();
+    int reserveCpu = -1;
+    if (miningOpts.Has("reserveCpu") && miningOpts.Get("reserveCpu").IsNumber()) {
+        reserveCpu = miningOpts.Get("reserveCpu").As<Number>().Int32Value();
+    }
+    bool networkPriority = miningOpts.Has("networkPriority") &&
+                           miningOpts.Get("networkPriority").ToBoolean().Value();
+    bool cycleAccounting = miningOpts.Has("cycleAccounting") &&
+                           miningOpts.Get("cycleAccounting").ToBoolean().Value();
+    if (miningOpts.Has("logLevel") && miningOpts.Get("logLevel").IsString()) {
+        kuzadesign::logging::Level level;
+        if (kuzadesign::logging::parseLevel(miningOpts.Get("logLevel").As<String>().Utf8Value(), level)) {
+            kuzadesign::logging::setLevel(level);
+        }
+    }
+    float tempLimit = 0.0f;
+    if (miningOpts.Has("tempLimit") && miningOpts.Get("tempLimit").IsNumber()) {
+        tempLimit = miningOpts.Get("tempLimit").As<Number>().FloatValue();
+    }
     
     // Stop if already running
     if (globalMiner) globalMiner->stop();
+    if (globalClient) globalClient->stop();
+    if (clientThread.joinable()) clientThread.join();
     if (globalClient) globalClient->disconnect();
-    if (clientThread.joinable()) {
-        clientRunning = false;
-        clientThread.join();
-    }
 
     // Initialize components
     globalMiner = std::make_unique<kuzadesign::Miner>();
@@ -96,15 +127,24 @@ Value StartMining(const CallbackInfo& info) {
     kuzadesign::MiningConfig mineConfig;
     mineConfig.numThreads = threads;
     mineConfig.intensity = intensity;
+    mineConfig.placement = placement;
+    mineConfig.tempLimit = tempLimit;
+    mineConfig.autotune = autotune;
+    mineConfig.efficiencyMode = efficiency;
+    mineConfig.scheduling = scheduling;
+    mineConfig.yieldToForeground = yieldToForeground;
+    mineConfig.reservedCpu = reserveCpu;
+    mineConfig.cycleAccounting = cycleAccounting;
     globalMiner->start(mineConfig);
     
-    // Start Network Thread
-    clientRunning = true;
-    clientThread = std::thread([]() {
-        while (clientRunning && globalClient && globalClient->isConnected()) {
-            globalClient->process();
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        }
+    // Start Network Thread: blocks in the client's event loop until
+    // StopMining() or the pool closes the connection
+    kuzadesign::stratum::Client* client = globalClient.get();
+    clientThread = std::thread([client, reserveCpu, networkPriority]() {
+        kuzadesign::trace::setThreadName("network");
+        if (reserveCpu >= 0) kuzadesign::pinCurrentThread(reserveCpu);
+        if (networkPriority) kuzadesign::setCurrentThreadScheduling(kuzadesign::SchedulingClass::Elevated);
+        client->run();
     });
     
     Object result = Object::New(env);
@@ -118,19 +158,66 @@ Value StopMining(const CallbackInfo& info) {
     Env env = info.Env();
     
     if (globalMiner) globalMiner->stop();
+    if (globalClient) globalClient->stop();
+    if (clientThread.joinable()) clientThread.join();
     if (globalClient) globalClient->disconnect();
     
-    clientRunning = false;
-    if (clientThread.joinable()) {
-        clientThread.join();
-    }
-    
     Object result = Object::New(env);
     result.Set("success", Boolean::New(env, true));
     
     return result;
 }
 
+// Change the worker count live (pool connection and job are kept)
+Value SetThreads(const CallbackInfo& info) {
+    Env env = info.Env();
+
+    if (info.Length() < 1 || !info[0].IsNumber()) {
+        TypeError::New(env, "Thread count required").ThrowAsJavaScriptException();
+        return env.Null();
+    }
+
+    bool ok = globalMiner && globalMiner->setThreadCount(info[0].As<Number>().Int32Value());
+
+    Object result = Object::New(env);
+    result.Set("success", Boolean::New(env, ok));
+    return result;
+}
+
+// Export the event trace rings as Chrome trace JSON: returns the JSON
+// string, or writes it to info[0] when a path is given
+Value DumpTrace(const CallbackInfo& info) {
+    Env env = info.Env();
+
+    if (info.Length() > 0 && info[0].IsString()) {
+        bool ok = kuzadesign::trace::writeChromeTrace(info[0].As<String>().Utf8Value());
+        Object result = Object::New(env);
+        result.Set("success", Boolean::New(env, ok));
+        return result;
+    }
+    return String::New(env, kuzadesign::trace::chromeTraceJson());
+}
+
+// One pipeline stage's latency distribution as { count, p50Us, p99Us, p999Us, maxUs }
+static Object LatencyObject(Env env, const kuzadesign::LatencySummary& summary) {
+    Object o = Object::New(env);
+    o.Set("count", Number::New(env, (double)summary.count));
+    o.Set("p50Us", Number::New(env, summary.p50Us));
+    o.Set("p99Us", Number::New(env, summary.p99Us));
+    o.Set("p999Us", Number::New(env, summary.p999Us));
+    o.Set("maxUs", Number::New(env, summary.maxUs));
+    return o;
+}
+
+// Mutex behaviour as { acquisitions, contended, wait: { count, p50Us, ... } }
+static Object LockObject(Env env, const kuzadesign::instrument::LockStats& lock) {
+    Object o = Object::New(env);
+    o.Set("acquisitions", Number::New(env, (double)lock.acquisitions));
+    o.Set("contended", Number::New(env, (double)lock.contended));
+    o.Set("wait", LatencyObject(env, lock.wait));
+    return o;
+}
+
 // Get mining stats
 Value GetStats(const CallbackInfo& info) {
     Env env = info.Env();
@@ -141,6 +228,12 @@ Value GetStats(const CallbackInfo& info) {
         auto minerStats = globalMiner->getStats();
         
         stats.Set("hashrate", Number::New(env, minerStats.hashrate));
+
+        Object hashrateWindows = Object::New(env);
+        hashrateWindows.Set("10s", Number::New(env, minerStats.hashrate10s));
+        hashrateWindows.Set("60s", Number::New(env, minerStats.hashrate60s));
+        hashrateWindows.Set("15m", Number::New(env, minerStats.hashrate15m));
+        stats.Set("hashrateWindows", hashrateWindows);
         
         Object shares = Object::New(env);
         shares.Set("accepted", Number::New(env, minerStats.sharesAccepted));
@@ -151,6 +244,82 @@ Value GetStats(const CallbackInfo& info) {
         stats.Set("connected", Boolean::New(env, globalClient && globalClient->isConnected()));
         stats.Set("cpuTemp", Number::New(env, minerStats.cpuTemp));
         stats.Set("cpuUsage", Number::New(env, minerStats.cpuUsage));
+        stats.Set("dutyCycle", Number::New(env, minerStats.dutyCycle));
+        stats.Set("thermalScale", Number::New(env, minerStats.thermalScale));
+        stats.Set("usableCpus", Number::New(env, minerStats.usableCpus));
+        stats.Set("cpuQuota", Number::New(env, minerStats.cpuQuota));
+        stats.Set("stealPercent", Number::New(env, minerStats.stealPercent));
+        stats.Set("workerEfficiency", Number::New(env, minerStats.workerEfficiency));
+        stats.Set("tunedThreads", Number::New(env, minerStats.tunedThreads));
+        stats.Set("placement", String::New(env, kuzadesign::placementPolicyName(minerStats.placement)));
+
+        Object energy = Object::New(env);
+        energy.Set("powerWatts", Number::New(env, minerStats.powerWatts));
+        energy.Set("hashesPerJoule", Number::New(env, minerStats.hashesPerJoule));
+        energy.Set("joules", Number::New(env, minerStats.energyJoules));
+        stats.Set("energy", energy);
+        stats.Set("cpuPressure", Number::New(env, minerStats.cpuPressure));
+        stats.Set("foregroundScale", Number::New(env, minerStats.foregroundScale));
+
+        Object notifyLatency = Object::New(env);
+        notifyLatency.Set("lastUs", Number::New(env, minerStats.notifyLatencyUs));
+        notifyLatency.Set("avgUs", Number::New(env, minerStats.notifyLatencyAvgUs));
+        notifyLatency.Set("maxUs", Number::New(env, minerStats.notifyLatencyMaxUs));
+        stats.Set("notifyLatency", notifyLatency);
+        stats.Set("reservedCpu", Number::New(env, minerStats.reservedCpu));
+
+        Object latency = Object::New(env);
+        latency.Set("readToHandled", LatencyObject(env, minerStats.readToHandled));
+        latency.Set("notifyToSetJob", LatencyObject(env, minerStats.notifyToSetJob));
+        latency.Set("setJobToFirstHash", LatencyObject(env, minerStats.setJobToFirstHash));
+        latency.Set("candidateToEnqueue", LatencyObject(env, minerStats.candidateToEnqueue));
+        latency.Set("submitToAck", LatencyObject(env, minerStats.submitToAck));
+        stats.Set("latency", latency);
+
+        Object locks = Object::New(env);
+        locks.Set("job", LockObject(env, minerStats.jobLock));
+        locks.Set("send", LockObject(env, minerStats.sendLock));
+        stats.Set("locks", locks);
+
+        // Only builds configured with KZD_INSTRUMENT count allocations
+        if (minerStats.allocationTracking) {
+            Object allocations = Object::New(env);
+            for (size_t i = 0; i < (size_t)kuzadesign::instrument::Subsystem::Count; i++) {
+                Object subsystem = Object::New(env);
+                subsystem.Set("count", Number::New(env, (double)minerStats.allocations[i].allocations));
+                subsystem.Set("bytes", Number::New(env, (double)minerStats.allocations[i].bytes));
+                allocations.Set(kuzadesign::instrument::subsystemName((kuzadesign::instrument::Subsystem)i), subsystem);
+            }
+            stats.Set("allocations", allocations);
+        }
+
+        Object memory = Object::New(env);
+        memory.Set("arenaBytes", Number::New(env, (double)minerStats.arenaBytes));
+        memory.Set("hugePageBytes", Number::New(env, (double)minerStats.hugePageBytes));
+        stats.Set("memory", memory);
+
+        Array workers = Array::New(env, minerStats.workers.size());
+        for (size_t i = 0; i < minerStats.workers.size(); i++) {
+            const auto& w = minerStats.workers[i];
+            Object worker = Object::New(env);
+            worker.Set("id", Number::New(env, w.threadId));
+            worker.Set("cpu", Number::New(env, w.cpu));
+            worker.Set("node", Number::New(env, w.node));
+            worker.Set("hashes", Number::New(env, (double)w.hashes));
+            if (minerStats.cycleAccounting) {
+                // Fractions of the worker's cycles (sum to 1)
+                Object cycles = Object::New(env);
+                cycles.Set("hash", Number::New(env, w.cycles.fraction(w.cycles.hash)));
+                cycles.Set("targetCheck", Number::New(env, w.cycles.fraction(w.cycles.targetCheck)));
+                cycles.Set("jobCheck", Number::New(env, w.cycles.fraction(w.cycles.jobCheck)));
+                cycles.Set("share", Number::New(env, w.cycles.fraction(w.cycles.share)));
+                cycles.Set("idle", Number::New(env, w.cycles.fraction(w.cycles.idle)));
+                cycles.Set("other", Number::New(env, w.cycles.fraction(w.cycles.other)));
+                worker.Set("cycles", cycles);
+            }
+            workers.Set((uint32_t)i, worker);
+        }
+        stats.Set("workers", workers);
     } else {
         stats.Set("hashrate", Number::New(env, 0));
         Object shares = Object::New(env);
@@ -169,6 +338,8 @@ Object Init(Env env, Object exports) {
     exports.Set("start", Function::New(env, StartMining));
     exports.Set("stop", Function::New(env, StopMining));
     exports.Set("getStats", Function::New(env, GetStats));
+    exports.Set("setThreads", Function::New(env, SetThreads));
+    exports.Set("dumpTrace", Function::New(env, DumpTrace));
     
     return exports;
 }
@@ -0,0 +1,87 @@
+#ifndef KUZADESIGN_ARENA_H
+#define KUZADESIGN_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+
+namespace kuzadesign {
+
+/**
+ * Per-worker bump allocator for algorithm state (input blocks, digests,
+ * matrices). The whole arena is one mapping so the hot working set sits
+ * behind as few TLB entries as possible.
+ *
+ * Backing is chosen at construction, best first. The huge-page kinds are
+ * only tried for arenas of at least HUGE_PAGE_SIZE: rounding a small arena
+ * up to 2 MB would make it resident for a few cache lines of state.
+ *   HugeTLB         - explicit 2 MB pages (MAP_HUGETLB / MEM_LARGE_PAGES)
+ *   TransparentHuge - 2 MB aligned mapping advised with MADV_HUGEPAGE; only
+ *                     a hint, so the kernel may still back it with 4 KB pages
+ *   Normal          - plain anonymous mapping (4 KB pages)
+ *   Heap            - aligned heap block, used when mapping fails
+ */
+class Arena {
+public:
+    enum class Backing {
+        HugeTLB,
+        TransparentHuge,
+        Normal,
+        Heap
+    };
+
+    static constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+    /**
+     * @param capacity Bytes the caller will place in the arena
+     * @param useHugePages Try 2 MB pages (only when capacity >= HUGE_PAGE_SIZE)
+     */
+    explicit Arena(size_t capacity = HUGE_PAGE_SIZE, bool useHugePages = true);
+    ~Arena();
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /**
+     * Allocate from the arena
+     *
+     * @param size Number of bytes
+     * @param alignment Power-of-two alignment (defaults to a cache line)
+     * @return Pointer to the block, or nullptr if the arena is exhausted
+     */
+    void* allocate(size_t size, size_t alignment = 64);
+
+    template <typename T>
+    T* allocateArray(size_t count) {
+        return static_cast<T*>(allocate(sizeof(T) * count, alignof(T) > 64 ? alignof(T) : 64));
+    }
+
+    // Drop all allocations (memory stays mapped)
+    void reset();
+
+    size_t capacity() const { return m_capacity; }
+    size_t used() const { return m_used; }
+    Backing backing() const { return m_backing; }
+
+    /**
+     * Bytes of the arena actually on huge pages, measured rather than
+     * assumed: all of it for HugeTLB, the AnonHugePages the kernel reports
+     * for the mapping under THP (0 when it declined or has not promoted it
+     * yet), 0 otherwise. Reads /proc/self/smaps, so keep it off hot paths.
+     */
+    size_t hugePageBytes() const;
+
+    static const char* backingName(Backing backing);
+
+private:
+    uint8_t* m_base = nullptr;
+    size_t m_capacity = 0;
+    size_t m_mappedSize = 0;
+    size_t m_used = 0;
+    Backing m_backing = Backing::Heap;
+
+    void release();
+};
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_ARENA_H
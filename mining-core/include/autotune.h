@@ -0,0 +1,83 @@
+#ifndef KUZADESIGN_AUTOTUNE_H
+#define KUZADESIGN_AUTOTUNE_H
+
+#include <vector>
+#include "topology.h"
+
+namespace kuzadesign {
+
+struct TuneSetting {
+    int threads = 1;
+    PlacementPolicy placement = PlacementPolicy::None;
+    float intensity = 1.0f;
+
+    bool operator==(const TuneSetting& other) const {
+        return threads == other.threads && placement == other.placement &&
+               intensity == other.intensity;
+    }
+    bool operator!=(const TuneSetting& other) const { return !(*this == other); }
+};
+
+/**
+ * Online hill climber for worker count, placement and (optionally)
+ * intensity.
+ *
+ * The caller measures a score (e.g. windowed hashrate) for whatever
+ * setting is applied and feeds it to next(). Windows alternate between a
+ * baseline at the current best setting and a trial of one perturbation,
+ * so each decision compares two back-to-back measurements and slow drift
+ * (temperature, other load) does not bias it.
+ */
+class AutoTuner {
+public:
+    /**
+     * @param minThreads Floor the tuner never goes below (guard rail)
+     * @param maxThreads Ceiling, normally the usable CPU count
+     * @param placements Policies to explore; empty = thread count only
+     * @param margin Relative gain a trial needs to be kept (noise guard)
+     */
+    AutoTuner(int minThreads, int maxThreads,
+              const std::vector<PlacementPolicy>& placements = {},
+              double margin = 0.02);
+
+    /**
+     * @param current Setting that was applied while score was measured
+     * @param score Measured score, higher is better
+     * @return Setting to apply for the next window
+     */
+    TuneSetting next(const TuneSetting& current, double score);
+
+    void setThreadLimits(int minThreads, int maxThreads);
+
+    /**
+     * Also explore intensity in [minIntensity, maxIntensity] by step.
+     * Off by default; step <= 0 disables it again.
+     */
+    void setIntensityRange(float minIntensity, float maxIntensity, float step);
+    const TuneSetting& best() const { return m_best; }
+
+private:
+    enum class Phase { Baseline, Trial };
+    enum class Dimension { Threads, Placement, Intensity };
+
+    int m_minThreads;
+    int m_maxThreads;
+    std::vector<PlacementPolicy> m_placements;
+    double m_margin;
+    float m_minIntensity = 1.0f;
+    float m_maxIntensity = 1.0f;
+    float m_intensityStep = 0.0f;
+
+    Phase m_phase = Phase::Baseline;
+    Dimension m_dimension = Dimension::Threads;
+    int m_direction = 1;
+    TuneSetting m_best;
+    double m_baselineScore = 0;
+
+    TuneSetting perturb(const TuneSetting& from);
+    void advanceDimension();
+};
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_AUTOTUNE_H
@@ -0,0 +1,49 @@
+#ifndef KUZADESIGN_CYCLES_H
+#define KUZADESIGN_CYCLES_H
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    #include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h>
+#endif
+
+namespace kuzadesign {
+
+/**
+ * Cheapest monotonic counter on this CPU: the TSC on x86, the virtual
+ * counter on ARM64, steady_clock nanoseconds elsewhere. Used for cycle
+ * accounting inside the hashing loop, where a clock_gettime() per hash
+ * would cost more than what it measures. Units are not calibrated; only
+ * ratios of differences taken on one thread are meaningful.
+ */
+inline uint64_t readCycleCounter() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+inline const char* cycleCounterName() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    return "rdtsc";
+#elif defined(__aarch64__)
+    return "cntvct";
+#else
+    return "steady_clock";
+#endif
+}
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_CYCLES_H
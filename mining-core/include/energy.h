@@ -0,0 +1,55 @@
+#ifndef KUZADESIGN_ENERGY_H
+#define KUZADESIGN_ENERGY_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace kuzadesign {
+
+/**
+ * Package energy from the Linux powercap RAPL interface
+ * (/sys/class/powercap/intel-rapl:N/energy_uj, also used by AMD).
+ *
+ * The counters are per package, in microjoules, and wrap at
+ * max_energy_range_uj; sample() returns the wrap-corrected total across
+ * all packages. File access goes through a FileReader so tests can feed
+ * synthetic counters on any machine.
+ */
+class EnergyMeter {
+public:
+    using FileReader = std::function<bool(const std::string& path, std::string& contents)>;
+
+    explicit EnergyMeter(const std::string& powercapRoot = "/sys/class/powercap",
+                         FileReader reader = FileReader());
+
+    // At least one readable package counter was found
+    bool available() const { return !m_zones.empty(); }
+    size_t packageCount() const { return m_zones.size(); }
+
+    /**
+     * Read all package counters
+     *
+     * @param joules Energy used by all packages since construction
+     * @return false if no counter could be read
+     */
+    bool sample(double& joules);
+
+private:
+    struct Zone {
+        std::string energyPath;
+        uint64_t maxRange = 0;
+        uint64_t last = 0;
+    };
+
+    FileReader m_reader;
+    std::vector<Zone> m_zones;
+    double m_totalJoules = 0;
+
+    bool readCounter(const std::string& path, uint64_t& value) const;
+};
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_ENERGY_H
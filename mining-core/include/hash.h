@@ -1,12 +1,15 @@
 #ifndef KUZADESIGN_HASH_H
 #define KUZADESIGN_HASH_H
 
+#include <cstddef>
 #include <cstdint>
 #include <vector>
 #include <string>
 
 namespace kuzadesign {
 
+constexpr size_t HASH_SIZE = 32;
+
 std::vector<uint8_t> hexToBytes(const std::string& hex);
 std::vector<uint8_t> targetFromNBits(const std::string& nbitsHex);
 
@@ -19,6 +22,15 @@ std::vector<uint8_t> targetFromNBits(const std::string& nbitsHex);
  */
 std::vector<uint8_t> calculateHash(const std::vector<uint8_t>& data, uint64_t nonce);
 
+/**
+ * Calculate hash into a caller-owned buffer (no allocation, hot path)
+ *
+ * @param data Block header data
+ * @param len Length of data in bytes
+ * @param out Output buffer of HASH_SIZE bytes
+ */
+void calculateHash(const uint8_t* data, size_t len, uint8_t* out);
+
 /**
  * Check if hash meets difficulty target
  * 
@@ -27,6 +39,10 @@ std::vector<uint8_t> calculateHash(const std::vector<uint8_t>& data, uint64_t no
  * @return true if hash < target
  */
 bool checkDifficulty(const std::vector<uint8_t>& hash, const std::vector<uint8_t>& target);
+bool checkDifficulty(const uint8_t* hash, const uint8_t* target, size_t len);
+
+// Name of the hash implementation compiled in (reported by benchmarks)
+const char* hashKernelName();
 
 /**
  * Convert hash to hex string
@@ -0,0 +1,96 @@
+#ifndef KUZADESIGN_INSTRUMENT_H
+#define KUZADESIGN_INSTRUMENT_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include "latency.h"
+
+namespace kuzadesign {
+namespace instrument {
+
+/**
+ * Lock and allocation instrumentation.
+ *
+ * Lock statistics are always collected: an acquisition costs one relaxed
+ * increment, and the wait is only timed when try_lock() fails (the thread
+ * is about to block anyway). Allocation counting replaces the global
+ * operator new and the cJSON allocator, so it only exists in builds
+ * configured with -DKZD_INSTRUMENT=ON; allocationTracking() tells which
+ * kind of build this is.
+ */
+enum class Lock { Job, Send, Count };
+
+// Allocations are charged to the subsystem the allocating thread is in
+enum class Subsystem { Core, Worker, Network, Monitor, Stats, Metrics, Count };
+
+const char* lockName(Lock lock);
+const char* subsystemName(Subsystem subsystem);
+
+struct LockStats {
+    uint64_t acquisitions = 0;
+    uint64_t contended = 0;     // Acquisitions that had to wait
+    LatencySummary wait;        // Wait time of the contended ones
+};
+
+struct AllocationStats {
+    uint64_t allocations = 0;
+    uint64_t bytes = 0;
+};
+
+LockStats lockStats(Lock lock);
+const LatencyHistogram& lockWaitHistogram(Lock lock);
+AllocationStats allocationStats(Subsystem subsystem);
+bool allocationTracking();
+
+// Charges the calling thread's allocations to a subsystem until destroyed
+class AllocationScope {
+public:
+    explicit AllocationScope(Subsystem subsystem);
+    ~AllocationScope();
+
+    AllocationScope(const AllocationScope&) = delete;
+    AllocationScope& operator=(const AllocationScope&) = delete;
+
+private:
+    Subsystem m_saved;
+};
+
+namespace detail {
+extern std::atomic<uint64_t> lockAcquisitions[(size_t)Lock::Count];
+void lockContended(std::mutex& mutex, Lock lock);
+}
+
+} // namespace instrument
+
+/**
+ * std::mutex that feeds instrument::lockStats(). Satisfies Lockable, so it
+ * works with lock_guard/unique_lock and std::condition_variable_any.
+ */
+class InstrumentedMutex {
+public:
+    explicit InstrumentedMutex(instrument::Lock kind) : m_kind(kind) {}
+
+    InstrumentedMutex(const InstrumentedMutex&) = delete;
+    InstrumentedMutex& operator=(const InstrumentedMutex&) = delete;
+
+    void lock() {
+        if (!m_mutex.try_lock()) instrument::detail::lockContended(m_mutex, m_kind);
+        instrument::detail::lockAcquisitions[(size_t)m_kind].fetch_add(1, std::memory_order_relaxed);
+    }
+    bool try_lock() {
+        if (!m_mutex.try_lock()) return false;
+        instrument::detail::lockAcquisitions[(size_t)m_kind].fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+    void unlock() { m_mutex.unlock(); }
+
+private:
+    std::mutex m_mutex;
+    instrument::Lock m_kind;
+};
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_INSTRUMENT_H
@@ -0,0 +1,96 @@
+#ifndef KUZADESIGN_LATENCY_H
+#define KUZADESIGN_LATENCY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace kuzadesign {
+
+/**
+ * HDR-style latency histogram over nanosecond values.
+ *
+ * Buckets are log-linear: every power of two is split into 32 linear
+ * sub-buckets, so any recorded value is reported within ~3% while the
+ * whole table (1 ns to ~18 minutes) stays at ~9 KB. Recording is a single
+ * relaxed atomic increment, safe from any number of threads and free of
+ * allocation; larger values are clamped into the top bucket.
+ */
+class LatencyHistogram {
+public:
+    static constexpr int kSubBucketBits = 5;
+    static constexpr int kMaxValueBits = 40;
+    static constexpr size_t kBucketCount =
+        (size_t)(kMaxValueBits - kSubBucketBits + 1) << kSubBucketBits;
+
+    LatencyHistogram();
+
+    void record(uint64_t ns);
+    void record(std::chrono::steady_clock::duration elapsed);
+
+    uint64_t count() const;
+    uint64_t max() const;
+    uint64_t sum() const;
+
+    // Values recorded into buckets entirely at or below ns (cumulative
+    // counts for coarse exported histograms)
+    uint64_t countAtOrBelow(uint64_t ns) const;
+
+    // Highest value equivalent to the bucket holding the given percentile
+    // (0-100); 0 when nothing has been recorded
+    uint64_t valueAtPercentile(double percentile) const;
+
+    void reset();
+
+    // Bucket index for a value and the largest value mapping to a bucket
+    static size_t bucketFor(uint64_t ns);
+    static uint64_t highestEquivalent(size_t bucket);
+
+private:
+    std::atomic<uint64_t> m_counts[kBucketCount];
+    std::atomic<uint64_t> m_total{0};
+    std::atomic<uint64_t> m_sum{0};
+    std::atomic<uint64_t> m_max{0};
+};
+
+/** Snapshot of one histogram in microseconds, as published in MiningStats. */
+struct LatencySummary {
+    uint64_t count = 0;
+    double p50Us = 0.0;
+    double p99Us = 0.0;
+    double p999Us = 0.0;
+    double maxUs = 0.0;
+};
+
+LatencySummary summarize(const LatencyHistogram& histogram);
+
+namespace latency {
+
+/**
+ * Share pipeline stages, each with a process-wide histogram (like the
+ * trace rings, so the client and the miner record without knowing about
+ * each other).
+ */
+enum class Stage {
+    ReadToHandled,      // Socket receive to handleMessage() returning, per line
+    NotifyToSetJob,     // mining.notify reaching the socket to Miner::setJob()
+    SetJobToFirstHash,  // setJob() to a worker's first hash of the job, per worker
+    CandidateToEnqueue, // Worker finding a candidate to the share callback returning, i.e. the
+                        // submit queued for the network thread (not yet on the wire)
+    SubmitToAck,        // mining.submit queued to the pool's response with the same id
+    Count
+};
+
+const char* stageName(Stage stage);
+
+void record(Stage stage, std::chrono::steady_clock::duration elapsed);
+LatencyHistogram& histogram(Stage stage);
+LatencySummary summary(Stage stage);
+void resetAll();
+
+} // namespace latency
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_LATENCY_H
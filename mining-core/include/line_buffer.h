@@ -0,0 +1,57 @@
+#ifndef KUZADESIGN_LINE_BUFFER_H
+#define KUZADESIGN_LINE_BUFFER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace kuzadesign {
+namespace stratum {
+
+/**
+ * Fixed receive slab that frames newline-delimited messages in place.
+ *
+ * recv() writes straight into writePtr(); nextLine() scans only bytes it
+ * has not seen before and hands out views into the slab, so a burst of N
+ * lines costs one pass over the data and at most one move of the trailing
+ * partial line per read. Nothing is allocated after construction. A line
+ * longer than the whole slab is dropped (counted by overflows()) up to
+ * its newline.
+ */
+class LineBuffer {
+public:
+    static constexpr size_t kDefaultCapacity = 64 * 1024;
+
+    explicit LineBuffer(size_t capacity = kDefaultCapacity);
+
+    // Space to receive into; moves any partial line to the front first.
+    // Invalidates views returned by nextLine().
+    char* writePtr();
+    size_t writable();
+    void commit(size_t n);
+
+    // Next complete line without its '\n' (or "\r\n"); false when only a
+    // partial line, or nothing, is left. The view is valid until the next
+    // writePtr()/writable() call.
+    bool nextLine(std::string_view& line);
+
+    size_t pending() const { return m_end - m_start; }
+    uint64_t overflows() const { return m_overflows; }
+
+private:
+    void compact();
+
+    std::unique_ptr<char[]> m_data;
+    size_t m_capacity;
+    size_t m_start = 0;         // First byte not yet handed out
+    size_t m_scan = 0;          // Bytes before this hold no newline
+    size_t m_end = 0;           // End of received data
+    bool m_discarding = false;  // Skipping the rest of an overlong line
+    uint64_t m_overflows = 0;
+};
+
+} // namespace stratum
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_LINE_BUFFER_H
@@ -0,0 +1,64 @@
+#ifndef KUZADESIGN_LOG_H
+#define KUZADESIGN_LOG_H
+
+#include <cstdint>
+#include <string>
+
+#if defined(__GNUC__) && !defined(_WIN32)
+    #define KZD_PRINTF_FORMAT(fmt, args) __attribute__((format(printf, fmt, args)))
+#else
+    #define KZD_PRINTF_FORMAT(fmt, args)
+#endif
+
+namespace kuzadesign {
+namespace logging {
+
+/**
+ * Asynchronous leveled logger for mining_core.
+ *
+ * Callers format into a slot of a fixed lock-free ring and return; a
+ * background thread writes the lines (Debug/Info to stdout, Warn/Error to
+ * stderr) and flushes once per drain, so hashing and network threads never
+ * block on console I/O. Nothing is allocated per message. When the ring is
+ * full, or more than the rate limit of sub-Error lines arrive in a second,
+ * messages are dropped and a summary line reports how many. Status lines
+ * are never rate limited.
+ */
+enum class Level { Debug, Info, Warn, Error, Off };
+
+const char* levelName(Level level);
+bool parseLevel(const std::string& name, Level& level);
+
+// Messages below the level are discarded before formatting (default Info)
+void setLevel(Level level);
+Level level();
+inline bool enabled(Level lvl) { return lvl >= level() && lvl != Level::Off; }
+
+// Lines per second allowed below Error (0 = unlimited, default 200)
+void setRateLimit(uint32_t linesPerSecond);
+
+void write(Level level, const char* format, ...) KZD_PRINTF_FORMAT(2, 3);
+void debug(const char* format, ...) KZD_PRINTF_FORMAT(1, 2);
+void info(const char* format, ...) KZD_PRINTF_FORMAT(1, 2);
+void warn(const char* format, ...) KZD_PRINTF_FORMAT(1, 2);
+void error(const char* format, ...) KZD_PRINTF_FORMAT(1, 2);
+
+// Lines another program parses (the Electron front end reads "[STATS]|..."
+// and "Connected to ..." from kzd-miner's stdout): written to stdout like
+// Info, but neither rate limited nor hidden by the level unless it is Off
+void status(const char* format, ...) KZD_PRINTF_FORMAT(1, 2);
+
+// Block until everything logged so far is written (bounded wait)
+void flush();
+
+struct Counters {
+    uint64_t written = 0;
+    uint64_t suppressed = 0;    // Over the rate limit
+    uint64_t dropped = 0;       // Ring full
+};
+Counters counters();
+
+} // namespace logging
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_LOG_H
@@ -0,0 +1,67 @@
+#ifndef KUZADESIGN_METRICS_H
+#define KUZADESIGN_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <string>
+#include <thread>
+#include "miner.h"
+#include "stratum.h"
+
+namespace kuzadesign {
+
+// State that lives outside the miner (pool connection, share verdicts)
+struct MetricsInfo {
+    bool connected = false;
+    stratum::ShareCounts shares;
+};
+
+/**
+ * OpenMetrics text exposition of the miner: hashrate windows, per-worker
+ * counters, share counts, the pipeline latency histograms, governor state,
+ * connection state and build/kernel info. Ends with "# EOF".
+ */
+std::string renderOpenMetrics(const MiningStats& stats, const MetricsInfo& info);
+
+/**
+ * Minimal HTTP/1.0 listener serving GET /metrics.
+ *
+ * Runs on its own thread with plain sockets. The body comes from a
+ * provider callback and is reused for minRefreshMs, so a scrape storm
+ * cannot make the stats path (and the locks workers share with it) busier
+ * than once per interval.
+ */
+class MetricsServer {
+public:
+    using Provider = std::function<std::string()>;
+
+    MetricsServer();
+    ~MetricsServer();
+
+    // Binds and starts serving; false (with a message on stderr) if the
+    // address cannot be bound. Port 0 picks a free port, see port().
+    bool start(const std::string& bindAddress, int port, Provider provider, int minRefreshMs = 1000);
+    void stop();
+
+    bool isRunning() const;
+    int port() const;
+
+private:
+    void serve();
+    void handleConnection(socket_t fd);
+    std::string body();
+
+    socket_t m_listenFd;
+    int m_port = 0;
+    std::atomic<bool> m_running{false};
+    std::thread m_thread;
+    Provider m_provider;
+    std::chrono::milliseconds m_minRefresh{1000};
+    std::string m_cachedBody;           // Only touched by the server thread
+    std::chrono::steady_clock::time_point m_cachedAt;
+};
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_METRICS_H
@@ -7,25 +7,175 @@
 #include <atomic>
 #include <functional>
 #include <mutex>
+#include <memory>
+#include <chrono>
+#include <condition_variable>
 #include "stratum.h"
+#include "topology.h"
+#include "autotune.h"
+#include "latency.h"
+#include "instrument.h"
+#include <deque>
 
 namespace kuzadesign {
 
 struct MiningConfig {
     std::string poolUrl;
     std::string walletAddress;
-    int numThreads = 4;
-    float intensity = 0.75f;
+    int numThreads = 0;         // 0 = auto: affinity mask capped by the cgroup CPU quota
+    float intensity = 0.75f;    // Target fraction of wall time each worker spends hashing
+    bool hugePages = true;      // Back worker arenas of 2 MB or more with huge pages when available
+    int batchTargetUs = 200;    // Wall time each inner hashing batch should take
+    PlacementPolicy placement = PlacementPolicy::None;
+    int numaNode = -1;          // Node for PlacementPolicy::NodeLocal (-1 = first node)
+
+    // Thermal governor (tempLimit 0 = off). Above the limit the miner backs
+    // off step by step; it recovers once the CPU is tempHysteresis below it.
+    float tempLimit = 0.0f;
+    float tempHysteresis = 5.0f;
+    bool throttleThreads = false;   // Shed workers instead of lowering the duty cycle
+    int monitorIntervalMs = 1000;
+
+    // Steal-aware scaling for shared VMs: shed a worker per interval while
+    // smoothed steal time is above stealHigh %, add one back below stealLow %
+    bool stealScaling = false;
+    float stealHigh = 10.0f;
+    float stealLow = 3.0f;
+
+    // Online tuner: alternates baseline and trial windows, perturbing the
+    // worker count (never below autotuneMinThreads) and placement policy
+    bool autotune = false;
+    int autotuneMinThreads = 1;
+    int autotuneWindowSec = 20;
+    bool autotunePlacement = true;
+
+    // Tune for hashes per joule (RAPL package energy) instead of hashes per
+    // second, exploring intensity down to efficiencyMinIntensity as well.
+    // Implies autotune; falls back to hashrate if no energy counter exists.
+    bool efficiencyMode = false;
+    float efficiencyMinIntensity = 0.3f;
+
+    // Desktop friendliness: scheduling class of the hashing threads, and
+    // optionally halving the duty cycle while foreground CPU pressure
+    // (PSI avg10, or load above our own workers) exceeds pressureHigh %,
+    // recovering 10% per interval below pressureLow %
+    SchedulingClass scheduling = SchedulingClass::Normal;
+    bool yieldToForeground = false;
+    float pressureHigh = 10.0f;
+    float pressureLow = 2.0f;
+
+    // CPU kept free of workers for the network thread (-1 = none). The
+    // caller pins its network thread there; auto thread count drops by one.
+    int reservedCpu = -1;
+
+    // Split each worker's time into hashing, target check, job check, share
+    // handling and idle by reading the cycle counter around each step
+    bool cycleAccounting = false;
+};
+
+// Worker cycles per activity (MiningConfig::cycleAccounting). "other" is
+// what the loop spends outside the named steps: block construction, nonce
+// leases, batch calibration and stats.
+struct CycleBreakdown {
+    uint64_t hash = 0;
+    uint64_t targetCheck = 0;
+    uint64_t jobCheck = 0;          // Job mutex and job copy
+    uint64_t share = 0;             // Candidate logging and the share callback
+    uint64_t idle = 0;              // Duty-cycle sleeps and waiting for a first job
+    uint64_t other = 0;
+
+    uint64_t total() const { return hash + targetCheck + jobCheck + share + idle + other; }
+    double fraction(uint64_t bucket) const { return total() ? (double)bucket / total() : 0.0; }
+};
+
+struct WorkerStats {
+    int threadId = 0;
+    int cpu = -1;               // Pinned CPU, -1 if unpinned
+    int node = -1;              // NUMA node of that CPU
+    uint64_t hashes = 0;
+    uint32_t batchSize = 0;
+    uint64_t busyNs = 0;        // Time spent hashing
+    uint64_t idleNs = 0;        // Time spent in duty-cycle idle slices
+    uint64_t cpuNs = 0;         // Thread CPU time while hashing (< busyNs when preempted/stolen)
+    CycleBreakdown cycles;      // All zero unless cycle accounting is on
 };
 
 struct MiningStats {
-    double hashrate = 0.0;
+    double hashrate = 0.0;          // Average since start
+    double hashrate10s = 0.0;
+    double hashrate60s = 0.0;
+    double hashrate15m = 0.0;
     uint64_t sharesAccepted = 0;
     uint64_t sharesRejected = 0;
     uint64_t uptime = 0;
     bool connected = false;
     float cpuTemp = 0.0f;
     float cpuUsage = 0.0f;
+
+    // Worker arena footprint (bytes reserved / bytes on 2 MB pages)
+    uint64_t arenaBytes = 0;
+    uint64_t hugePageBytes = 0;
+
+    // Mean calibrated inner batch length across workers (hashes per batch)
+    uint32_t batchSize = 0;
+
+    // Achieved hashing duty cycle across workers (tracks intensity)
+    float dutyCycle = 0.0f;
+
+    // Thermal governor output: 1.0 = unthrottled
+    float thermalScale = 1.0f;
+
+    // CPUs available to this process (affinity + cgroup quota); quota -1 = none
+    int usableCpus = 0;
+    float cpuQuota = -1.0f;
+
+    // Hypervisor steal (percent of all CPU time) and the share of hashing
+    // wall time workers actually got on a CPU (1.0 = no loss)
+    float stealPercent = 0.0f;
+    float workerEfficiency = 1.0f;
+    int stealShedThreads = 0;
+
+    // Autotuner state (tunedThreads 0 = tuner off)
+    int tunedThreads = 0;
+    PlacementPolicy placement = PlacementPolicy::None;
+
+    // Package power and efficiency over the last monitor interval, and
+    // energy since start (all 0 when RAPL is unavailable)
+    double powerWatts = 0.0;
+    double hashesPerJoule = 0.0;
+    double energyJoules = 0.0;
+
+    // Foreground back-off: measured pressure (percent) and the duty-cycle
+    // scale it produced (1.0 = not backing off)
+    float cpuPressure = 0.0f;
+    float foregroundScale = 1.0f;
+
+    // Notify-to-dispatch: from the notify reaching the socket until the
+    // slowest worker is hashing the job (current job; mean/max of earlier ones)
+    double notifyLatencyUs = 0.0;
+    double notifyLatencyAvgUs = 0.0;
+    double notifyLatencyMaxUs = 0.0;
+    int reservedCpu = -1;
+
+    // Share pipeline latency distributions since start (see latency::Stage)
+    LatencySummary readToHandled;
+    LatencySummary notifyToSetJob;
+    LatencySummary setJobToFirstHash;
+    LatencySummary candidateToEnqueue;
+    LatencySummary submitToAck;
+
+    // Sum of the workers' cycle breakdowns (cycle accounting only)
+    bool cycleAccounting = false;
+    CycleBreakdown cycles;
+
+    // Acquisitions and contended waits on the job and send mutexes, and
+    // allocations per subsystem (all zero unless built with KZD_INSTRUMENT)
+    instrument::LockStats jobLock;
+    instrument::LockStats sendLock;
+    bool allocationTracking = false;
+    instrument::AllocationStats allocations[(size_t)instrument::Subsystem::Count];
+
+    std::vector<WorkerStats> workers;
 };
 
 class Miner {
@@ -37,10 +187,24 @@ public:
     bool start(const MiningConfig& config);
     void stop();
     bool isRunning() const;
+
+    // Add or retire workers without stopping the others. Retired workers
+    // return their unused nonce range for reuse. n = 0 selects auto mode
+    // (follows the usable CPU count). Returns false for n < 0 or while
+    // stopped; pass the count to start() instead.
+    bool setThreadCount(int n);
+    int getThreadCount() const;
+
+    // Re-pin live workers under a different policy
+    void setPlacement(PlacementPolicy policy);
     
     // Job management
     void setJob(const stratum::Job& job);
 
+    // Duty cycle (0.01 - 1.0); takes effect on the next batch
+    void setIntensity(float intensity);
+    float getIntensity() const;
+
     // Stats
     MiningStats getStats() const;
 
@@ -52,8 +216,92 @@ public:
     void setShareCallback(ShareCallback callback);
 
 private:
-    std::vector<std::thread> workers;
+    // Per-worker state, written by the worker and read by getStats()
+    struct WorkerContext {
+        int id = 0;
+        std::atomic<int> cpu{-1};       // Workers re-pin themselves when this changes
+        std::atomic<int> node{-1};
+        std::thread thread;
+        std::atomic<bool> retire{false};
+        std::atomic<uint64_t> hashes{0};
+        std::atomic<uint64_t> arenaBytes{0};
+        std::atomic<uint64_t> hugePageBytes{0};
+        std::atomic<uint32_t> batchSize{0};
+        std::atomic<uint64_t> busyNs{0};
+        std::atomic<uint64_t> idleNs{0};
+        std::atomic<uint64_t> cpuNs{0};
+
+        // Cycle accounting, published once per batch
+        std::atomic<uint64_t> cycleHash{0};
+        std::atomic<uint64_t> cycleTargetCheck{0};
+        std::atomic<uint64_t> cycleJobCheck{0};
+        std::atomic<uint64_t> cycleShare{0};
+        std::atomic<uint64_t> cycleIdle{0};
+        std::atomic<uint64_t> cycleTotal{0};
+    };
+
+    // Contiguous nonce range owned by one worker
+    struct NonceLease {
+        uint64_t next = 0;
+        uint64_t end = 0;
+    };
+
+    std::vector<std::unique_ptr<WorkerContext>> workers;
+    mutable std::mutex workersMutex;    // Guards the workers vector
     std::atomic<bool> running{false};
+    MiningConfig m_config;
+    CpuTopology m_topology;
+    std::vector<int> m_placementCpus;
+
+    // Nonce space is leased out so workers can join and leave without overlap
+    std::mutex leaseMutex;
+    uint64_t m_nextLease = 0;
+    std::vector<NonceLease> m_returnedLeases;
+
+    // Bumped whenever workers must recalibrate their batch length
+    // (thread count or hash kernel changed)
+    std::atomic<uint32_t> m_tuneEpoch{0};
+
+    std::atomic<float> m_intensity{1.0f};
+
+    // Monitor thread: samples CPU usage/temperature and runs the governor
+    std::thread m_monitorThread;
+    std::mutex monitorMutex;
+    std::condition_variable monitorCv;
+    std::atomic<float> m_cpuTemp{0.0f};
+    std::atomic<float> m_cpuUsage{0.0f};
+    std::atomic<float> m_thermalScale{1.0f};
+
+    // Auto thread count: usable CPUs and the duty-cycle share that keeps a
+    // fractional quota (e.g. 2.5 CPUs on 3 workers) from being throttled
+    std::atomic<int> m_usableCpus{1};
+    std::atomic<float> m_cpuQuota{-1.0f};
+    std::atomic<float> m_quotaScale{1.0f};
+
+    std::atomic<float> m_steal{0.0f};
+    std::atomic<float> m_workerEfficiency{1.0f};
+    std::atomic<int> m_stealShed{0};
+
+    // Thread count asked for by start() / setThreadCount(), 0 = auto. Workers
+    // and the monitor read it, so it is not kept in m_config.
+    std::atomic<int> m_requestedThreads{0};
+    std::atomic<int> m_tunedThreads{0};
+    std::atomic<PlacementPolicy> m_placement{PlacementPolicy::None};
+
+    std::atomic<double> m_powerWatts{0.0};
+    std::atomic<double> m_hashesPerJoule{0.0};
+    std::atomic<double> m_energyJoules{0.0};
+
+    std::atomic<float> m_cpuPressure{0.0f};
+    std::atomic<float> m_foregroundScale{1.0f};
+
+    // CPUs workers may run on when not pinned: the affinity mask at start()
+    // without reservedCpu
+    std::vector<int> m_workerCpus;
+
+    // (time, total hashes) once per monitor interval, for windowed hashrates
+    std::deque<std::pair<std::chrono::steady_clock::time_point, uint64_t>> m_hashSamples;
+    mutable std::mutex samplesMutex;
     MiningStats stats;
     ShareCallback shareCallback;
     
@@ -64,10 +312,33 @@ private:
     
     // Current Job
     stratum::Job currentJob;
-    std::mutex jobMutex;
+    mutable InstrumentedMutex jobMutex{instrument::Lock::Job};
+    std::condition_variable_any jobCv;
     bool hasJob = false;
+    uint64_t m_jobSeq = 0;
+    std::chrono::steady_clock::time_point m_jobPublishedAt;
+
+    // Dispatch latency bookkeeping, under jobMutex
+    int64_t m_jobDispatchNs = 0;        // Slowest pickup of the current job so far
+    uint64_t m_dispatchedJobs = 0;
+    double m_dispatchSumUs = 0.0;
+    double m_dispatchMaxUs = 0.0;
 
-    void workerThread(int threadId);
+    void workerThread(WorkerContext* ctx);
+    void spawnWorker(int id);
+    void resizeWorkers(int n);
+    int targetThreadCount() const;
+    float effectiveIntensity() const;
+    void monitorThread();
+    void updateThermalGovernor(float temp);
+    bool refreshUsableCpus();
+    void updateStealScaling(float smoothedSteal);
+    void updateForegroundBackoff(float pressure);
+    void assignCpu(WorkerContext* ctx);
+    std::vector<int> placementCpus(PlacementPolicy policy) const;
+    double windowedHashrate(std::chrono::seconds window) const;
+    NonceLease acquireLease();
+    void releaseLease(const NonceLease& lease);
     void updateHashrate();
 };
 
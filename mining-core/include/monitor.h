@@ -0,0 +1,62 @@
+#ifndef KUZADESIGN_MONITOR_H
+#define KUZADESIGN_MONITOR_H
+
+#include <cstdint>
+#include <string>
+
+namespace kuzadesign {
+
+/**
+ * Samples system-wide CPU usage (/proc/stat), CPU pressure and load
+ * (/proc/pressure/cpu, /proc/loadavg) and CPU temperature
+ * (/sys/class/thermal, falling back to hwmon). Each sample() costs a few
+ * small file reads, so it is meant to run about once a second.
+ */
+class SystemMonitor {
+public:
+    // Roots are injectable so tests can point at a fake tree
+    explicit SystemMonitor(const std::string& procRoot = "/proc",
+                           const std::string& sysRoot = "/sys");
+
+    /**
+     * Take a sample. Usage figures are deltas against the previous sample,
+     * so the first call only primes the counters.
+     *
+     * @return false if /proc/stat could not be read
+     */
+    bool sample();
+
+    float cpuUsage() const { return m_cpuUsage; }   // Percent of all CPUs busy
+    float cpuTemp() const { return m_cpuTemp; }     // Degrees C, 0 if unknown
+    float stealPercent() const { return m_steal; }  // Percent of time taken by the hypervisor
+
+    // PSI "some avg10": percent of time at least one runnable task waited
+    // for a CPU; -1 when the kernel has no PSI
+    float cpuPressure() const { return m_cpuPressure; }
+    float loadAverage() const { return m_loadAverage; }  // 1 minute
+
+private:
+    std::string m_procRoot;
+    std::string m_sysRoot;
+
+    uint64_t m_prevTotal = 0;
+    uint64_t m_prevIdle = 0;
+    uint64_t m_prevSteal = 0;
+    bool m_primed = false;
+
+    float m_cpuUsage = 0.0f;
+    float m_cpuTemp = 0.0f;
+    float m_steal = 0.0f;
+    float m_cpuPressure = -1.0f;
+    float m_loadAverage = 0.0f;
+
+    float readTemperature() const;
+    float readPressure() const;
+};
+
+// CPU time consumed by the calling thread, in nanoseconds (0 if unsupported)
+uint64_t threadCpuTimeNs();
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_MONITOR_H
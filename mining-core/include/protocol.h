@@ -0,0 +1,50 @@
+#ifndef KUZADESIGN_PROTOCOL_H
+#define KUZADESIGN_PROTOCOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace kuzadesign {
+namespace stratum {
+
+/**
+ * Allocation-free parser for the messages on the share latency path.
+ *
+ * Recognises three fixed shapes:
+ *   {"method":"mining.notify","params":[jobId, header, timestamp, ...]}
+ *     header is 64 hex digits or an array of four u64 (little endian)
+ *   {"method":"mining.set_difficulty","params":[difficulty, ...]}
+ *   {"id":n,"result":true|false|null,"error":null|[code,msg,...]|{code,message}}
+ * Keys may come in any order and unknown keys are skipped. Anything else
+ * (escaped strings, subscribe results, other methods, malformed input)
+ * makes parseFastMessage() return false so the caller can fall back to
+ * cJSON. Views in the result point into the parsed line.
+ */
+struct FastMessage {
+    enum class Kind { Notify, SetDifficulty, Response };
+    Kind kind = Kind::Response;
+
+    // Notify
+    std::string_view jobId;
+    uint8_t header[32] = {};
+    uint64_t timestamp = 0;
+
+    // SetDifficulty
+    double difficulty = 0.0;
+
+    // Response; id 0 when absent or null
+    uint64_t id = 0;
+    bool accepted = false;      // result was true
+    bool stale = false;         // error code 21 or a message containing "stale"
+};
+
+bool parseFastMessage(std::string_view line, FastMessage& message);
+
+// Case-insensitive "stale" test shared with the cJSON path
+bool mentionsStale(std::string_view text);
+
+} // namespace stratum
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_PROTOCOL_H
@@ -6,7 +6,13 @@
 #include <functional>
 #include <atomic>
 #include <mutex>
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <string_view>
 #include "hash.h"
+#include "instrument.h"
+#include "line_buffer.h"
 
 extern "C" {
 #include "../src/json/cJSON.h"
@@ -46,6 +52,19 @@ struct Job {
     // From subscribe
     std::vector<uint8_t> extraNonce1;
     int extraNonce2Size;
+
+    // When the notify reached the socket (kernel receive timestamp where
+    // available); default-constructed for jobs that did not come off the wire
+    std::chrono::steady_clock::time_point receivedAt{};
+};
+
+// Pool verdicts on submitted shares. Stale shares (error code 21 or a
+// "stale" message) are counted apart from other rejections.
+struct ShareCounts {
+    uint64_t submitted = 0;
+    uint64_t accepted = 0;
+    uint64_t rejected = 0;
+    uint64_t stale = 0;
 };
 
 class Client {
@@ -62,23 +81,69 @@ public:
     bool subscribe(const std::string& userAgent);
     bool submit(const std::string& jobId, uint32_t ntime, uint64_t nonce, uint64_t extraNonce2);
     
+    ShareCounts shareCounts() const;
+
     // Callbacks
     void onJob(std::function<void(const Job&)> callback);
     
     // Main loop for checking socket events (non-blocking or blocking with timeout)
     void process();
 
+    // Event loop for the network thread: handles input as soon as it
+    // arrives until stop() is called (returns true) or the connection is
+    // lost (returns false). Sleeps in epoll_wait on Linux, so an idle
+    // network thread uses no CPU; elsewhere select() with a 100 ms tick.
+    bool run();
+
+    // Makes run() return, from any thread; later calls return at once too
+    void stop();
+
+    // Hand received bytes to the line parser, as process() does after a
+    // recv(); lets tests and benchmarks drive the protocol without a socket
+    void feed(const char* data, size_t len);
+
 private:
     socket_t socket_fd;
-    bool connected;
+    std::atomic<bool> connected;
+    std::atomic<bool> stopRequested{false};
+    int wakeFd = -1;                    // eventfd that interrupts run() (Linux)
     std::string host;
     int port;
-    std::mutex sendMutex;
+
+    // Outbound messages, preformatted into fixed slots. Whoever holds
+    // sendMutex drains every queued slot with one scatter-gather send, so
+    // shares found together leave in one write; on EAGAIN the rest waits
+    // for run() to see the socket writable.
+    static constexpr size_t kOutboundSlots = 64;
+    static constexpr size_t kOutboundSlotBytes = 1024;
+    struct OutboundSlot {
+        size_t len = 0;
+        char text[kOutboundSlotBytes];
+    };
+    std::unique_ptr<OutboundSlot[]> outbound;
+    std::mutex outboundMutex;           // Guards outboundHead/outboundTail
+    uint64_t outboundHead = 0;          // Next slot to send
+    uint64_t outboundTail = 0;          // Next free slot
+    size_t outboundOffset = 0;          // Sent bytes of the head slot (sendMutex)
+    std::atomic<bool> wantWrite{false}; // Queue blocked; run() polls for writability
+    InstrumentedMutex sendMutex{instrument::Lock::Send};
+
+    // Submits get their own ids so acks can be matched for latency;
+    // unanswered ones are dropped oldest first
+    std::atomic<uint64_t> nextSubmitId{4};
+    std::mutex pendingMutex;
+    std::deque<std::pair<uint64_t, std::chrono::steady_clock::time_point>> pendingSubmits;
+    std::atomic<uint64_t> sharesSubmitted{0};
+    std::atomic<uint64_t> sharesAccepted{0};
+    std::atomic<uint64_t> sharesRejected{0};
+    std::atomic<uint64_t> sharesStale{0};
     
-    // Buffer for received data
-    std::string recvBuffer;
+    // Received data, framed into lines in place
+    LineBuffer recvLines;
+    std::chrono::steady_clock::time_point recvAt;
     
     std::function<void(const Job&)> jobCallback;
+    Job notifyJob;                      // Scratch job handed to jobCallback
     
     // Session data
     std::vector<uint8_t> extraNonce1;
@@ -86,8 +151,15 @@ private:
     double currentDifficulty = 1.0;
     
     // Protocol handling
-    void handleMessage(const std::string& line);
+    void handleMessage(std::string_view line);
+    void handleLines();
+    void onNotify(std::string_view jobId, const uint8_t* header, size_t headerLen, uint64_t timestamp);
+    void onSetDifficulty(double difficulty);
+    void onResponse(uint64_t requestId, bool accepted, bool subscribed, bool stale);
     bool sendJson(cJSON* json);
+    bool enqueue(const char* text, size_t len);
+    void flushOutbound();
+    void wake();
     
     // Helpers
     std::vector<std::string> split(const std::string& s, char delimiter);
@@ -0,0 +1,109 @@
+#ifndef KUZADESIGN_TOPOLOGY_H
+#define KUZADESIGN_TOPOLOGY_H
+
+#include <string>
+#include <vector>
+
+namespace kuzadesign {
+
+enum class PlacementPolicy {
+    None,           // Leave scheduling to the OS
+    Compact,        // Fill both SMT siblings of a core before the next core
+    Scatter,        // One thread per physical core first, alternating NUMA nodes
+    PhysicalCores,  // Only the first hardware thread of each core
+    NodeLocal       // Only CPUs of a single NUMA node (MiningConfig::numaNode)
+};
+
+// OS scheduling class for hashing (and the network) threads
+enum class SchedulingClass {
+    Normal,         // Default time sharing
+    Background,     // Nice 19 (THREAD_PRIORITY_LOWEST on Windows)
+    Idle,           // SCHED_IDLE: runs only when nothing else wants the CPU
+    Elevated        // Nice -10 (needs CAP_SYS_NICE), THREAD_PRIORITY_HIGHEST on Windows
+};
+
+struct CpuInfo {
+    int cpu = 0;          // Logical CPU id
+    int core = 0;         // core_id within its package
+    int package = 0;      // physical_package_id
+    int node = 0;         // NUMA node
+    int sibling = 0;      // 0 for the first hardware thread of a core, 1 for its SMT twin...
+};
+
+// CPU ids in the calling thread's affinity mask; empty when unknown
+std::vector<int> affinityCpus();
+
+class CpuTopology {
+public:
+    /**
+     * Discover CPUs, cores and NUMA nodes from sysfs
+     *
+     * Only CPUs in `allowed` are kept, so placement never escapes a taskset
+     * or cpuset restriction. SMT sibling indexes are assigned after the
+     * filter: a core whose first thread is excluded still has a sibling 0.
+     *
+     * @param sysRoot Root of the sysfs CPU/node tree (injectable for tests)
+     * @param allowed CPUs the process may run on; empty = no restriction
+     * @return Topology; falls back to one flat node when sysfs is unavailable
+     */
+    static CpuTopology discover(const std::string& sysRoot = "/sys/devices/system",
+                                const std::vector<int>& allowed = affinityCpus());
+
+    const std::vector<CpuInfo>& cpus() const { return m_cpus; }
+    int nodeCount() const;
+    int coreCount() const;
+    int nodeOf(int cpu) const;
+
+    /**
+     * Order CPUs for a placement policy. Worker i runs on result[i % size].
+     *
+     * @param policy Placement policy
+     * @param node NUMA node for NodeLocal (-1 = lowest node)
+     * @return CPU ids in assignment order; empty for PlacementPolicy::None
+     */
+    std::vector<int> placement(PlacementPolicy policy, int node = -1) const;
+
+private:
+    std::vector<CpuInfo> m_cpus;
+};
+
+// Parse a kernel CPU list such as "0-3,8,10-11"
+std::vector<int> parseCpuList(const std::string& list);
+
+/**
+ * CPU bandwidth limit of this process's cgroup, in CPUs
+ *
+ * Reads cpu.max (cgroup v2) or cpu.cfs_quota_us / cpu.cfs_period_us (v1)
+ * for the group in selfCgroupFile and its ancestors; the tightest wins.
+ *
+ * @return Quota in CPUs (e.g. 2.5), or -1 when unlimited / unknown
+ */
+double cgroupCpuQuota(const std::string& cgroupRoot = "/sys/fs/cgroup",
+                      const std::string& selfCgroupFile = "/proc/self/cgroup");
+
+// Number of CPUs in the calling thread's affinity mask
+int affinityCpuCount();
+
+/**
+ * CPUs the miner can really use: the affinity mask capped by the cgroup
+ * quota (rounded up; the duty cycle absorbs the fractional part)
+ */
+int detectUsableCpus(double* quota = nullptr);
+
+// Pin the calling thread to one logical CPU
+bool pinCurrentThread(int cpu);
+
+// Restrict the calling thread to a set of CPUs (e.g. all of them, to unpin)
+bool pinCurrentThread(const std::vector<int>& cpus);
+
+// Apply a scheduling class to the calling thread
+bool setCurrentThreadScheduling(SchedulingClass cls);
+
+const char* placementPolicyName(PlacementPolicy policy);
+bool parsePlacementPolicy(const std::string& name, PlacementPolicy& policy);
+const char* schedulingClassName(SchedulingClass cls);
+bool parseSchedulingClass(const std::string& name, SchedulingClass& cls);
+
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_TOPOLOGY_H
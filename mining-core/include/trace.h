@@ -0,0 +1,57 @@
+#ifndef KUZADESIGN_TRACE_H
+#define KUZADESIGN_TRACE_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+namespace kuzadesign {
+namespace trace {
+
+/**
+ * Always-on event tracing for the share pipeline.
+ *
+ * Each thread writes into its own fixed-size ring (no locks, no
+ * allocation after the thread's first event); old events are overwritten.
+ * Events are per job or per share, never per hash, so the cost is a
+ * clock read and a 48-byte store. A dump merges all rings into Chrome
+ * trace JSON (chrome://tracing, ui.perfetto.dev).
+ */
+enum class Event : uint8_t {
+    NotifyReceived,     // mining.notify reached the socket (kernel rx time when known)
+    JobPublished,       // Miner::setJob() made the job visible to workers
+    JobPickedUp,        // A worker switched to the job
+    CandidateFound,     // A worker found a hash under the target
+    SubmitQueued,       // mining.submit queued for sending
+    ResponseReceived    // Pool answered a request (tag: accepted / rejected)
+};
+
+const char* eventName(Event event);
+
+struct Record {
+    uint64_t ns;        // Steady clock, nanoseconds
+    uint64_t arg;       // Event specific: job sequence, nonce, request id
+    char tag[24];       // Usually the job id (truncated)
+    Event event;
+};
+
+// Global switch; tracing is on unless disabled
+void setEnabled(bool enabled);
+bool enabled();
+
+// Label the calling thread in dumps (e.g. "worker 3", "network")
+void setThreadName(const std::string& name);
+
+void record(Event event, const char* tag = nullptr, uint64_t arg = 0);
+void recordAt(Event event, std::chrono::steady_clock::time_point at,
+              const char* tag = nullptr, uint64_t arg = 0);
+
+// Chrome trace JSON of everything currently in the rings
+std::string chromeTraceJson();
+bool writeChromeTrace(const std::string& path);
+
+} // namespace trace
+} // namespace kuzadesign
+
+#endif // KUZADESIGN_TRACE_H
@@ -0,0 +1,214 @@
+#include "arena.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifdef _WIN32
+    #include <windows.h>
+    #include <malloc.h>
+#else
+    #include <sys/mman.h>
+    #include <unistd.h>
+#endif
+
+namespace kuzadesign {
+
+static size_t roundUp(size_t value, size_t multiple) {
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+#ifdef __linux__
+// AnonHugePages of the /proc/self/smaps entry containing addr, in bytes
+static size_t anonHugePageBytes(const void* addr) {
+    FILE* smaps = std::fopen("/proc/self/smaps", "r");
+    if (!smaps) return 0;
+
+    uintptr_t target = reinterpret_cast<uintptr_t>(addr);
+    bool inside = false;
+    size_t bytes = 0;
+    char line[512];
+    while (std::fgets(line, sizeof(line), smaps)) {
+        unsigned long start = 0, end = 0;
+        if (std::sscanf(line, "%lx-%lx ", &start, &end) == 2) {
+            // Next mapping; stop once we have read ours
+            if (inside) break;
+            inside = target >= start && target < end;
+            continue;
+        }
+        unsigned long kb = 0;
+        if (inside && std::sscanf(line, "AnonHugePages: %lu kB", &kb) == 1) {
+            bytes = (size_t)kb * 1024;
+            break;
+        }
+    }
+    std::fclose(smaps);
+    return bytes;
+}
+#endif
+
+Arena::Arena(size_t capacity, bool useHugePages) {
+    if (capacity == 0) capacity = HUGE_PAGE_SIZE;
+    if (capacity < HUGE_PAGE_SIZE) useHugePages = false;
+
+#ifdef _WIN32
+    if (useHugePages) {
+        SIZE_T largePage = GetLargePageMinimum();
+        if (largePage > 0) {
+            size_t size = roundUp(capacity, largePage);
+            void* p = VirtualAlloc(NULL, size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (p) {
+                m_base = static_cast<uint8_t*>(p);
+                m_capacity = m_mappedSize = size;
+                m_backing = Backing::HugeTLB;
+                return;
+            }
+        }
+    }
+
+    {
+        void* p = VirtualAlloc(NULL, capacity, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+        if (p) {
+            m_base = static_cast<uint8_t*>(p);
+            m_capacity = m_mappedSize = capacity;
+            m_backing = Backing::Normal;
+            return;
+        }
+    }
+#else
+    if (useHugePages) {
+        size_t size = roundUp(capacity, HUGE_PAGE_SIZE);
+        void* p = MAP_FAILED;
+
+#ifdef MAP_HUGETLB
+        // Explicit huge pages: only succeeds if the admin reserved some
+        // (vm.nr_hugepages), so failure here is the common case.
+        p = mmap(NULL, size, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            m_base = static_cast<uint8_t*>(p);
+            m_capacity = m_mappedSize = size;
+            m_backing = Backing::HugeTLB;
+        }
+#endif
+
+#ifdef MADV_HUGEPAGE
+        if (!m_base) {
+            // Transparent huge pages: over-map so we can carve out a 2 MB aligned
+            // window, otherwise the kernel cannot promote it to a huge page.
+            size_t mapped = size + HUGE_PAGE_SIZE;
+            p = mmap(NULL, mapped, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p != MAP_FAILED) {
+                uintptr_t start = reinterpret_cast<uintptr_t>(p);
+                uintptr_t aligned = roundUp(start, HUGE_PAGE_SIZE);
+                size_t head = aligned - start;
+                size_t tail = mapped - head - size;
+                if (head) munmap(p, head);
+                if (tail) munmap(reinterpret_cast<void*>(aligned + size), tail);
+
+                m_base = reinterpret_cast<uint8_t*>(aligned);
+                m_capacity = m_mappedSize = size;
+                m_backing = madvise(m_base, size, MADV_HUGEPAGE) == 0 ? Backing::TransparentHuge
+                                                                       : Backing::Normal;
+            }
+        }
+#endif
+    }
+
+    if (!m_base) {
+        size_t size = roundUp(capacity, static_cast<size_t>(sysconf(_SC_PAGESIZE)));
+        void* p = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p != MAP_FAILED) {
+            m_base = static_cast<uint8_t*>(p);
+            m_capacity = m_mappedSize = size;
+            m_backing = Backing::Normal;
+        }
+    }
+
+    if (m_base) {
+        // Fault the pages in from the owning thread so they land on its
+        // NUMA node (first touch) and the hot loop never page-faults.
+        long page = sysconf(_SC_PAGESIZE);
+        for (size_t off = 0; off < m_capacity; off += page) {
+            m_base[off] = 0;
+        }
+        return;
+    }
+#endif
+
+    // Last resort: ordinary heap memory
+    capacity = roundUp(capacity, 64);
+#ifdef _WIN32
+    m_base = static_cast<uint8_t*>(_aligned_malloc(capacity, 64));
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, 64, capacity) != 0) p = nullptr;
+    m_base = static_cast<uint8_t*>(p);
+#endif
+    if (m_base) {
+        std::memset(m_base, 0, capacity);
+        m_capacity = capacity;
+    }
+    m_backing = Backing::Heap;
+}
+
+Arena::~Arena() {
+    release();
+}
+
+void Arena::release() {
+    if (!m_base) return;
+
+    if (m_backing == Backing::Heap) {
+#ifdef _WIN32
+        _aligned_free(m_base);
+#else
+        free(m_base);
+#endif
+    } else {
+#ifdef _WIN32
+        VirtualFree(m_base, 0, MEM_RELEASE);
+#else
+        munmap(m_base, m_mappedSize);
+#endif
+    }
+    m_base = nullptr;
+    m_capacity = m_mappedSize = m_used = 0;
+}
+
+void* Arena::allocate(size_t size, size_t alignment) {
+    if (!m_base || alignment == 0 || (alignment & (alignment - 1)) != 0) return nullptr;
+
+    size_t offset = roundUp(m_used, alignment);
+    if (offset + size > m_capacity) return nullptr;
+
+    m_used = offset + size;
+    return m_base + offset;
+}
+
+void Arena::reset() {
+    m_used = 0;
+}
+
+size_t Arena::hugePageBytes() const {
+    if (!m_base) return 0;
+    if (m_backing == Backing::HugeTLB) return m_capacity;
+#ifdef __linux__
+    // The kernel may have merged our mapping with a neighbour advised the
+    // same way; never report more than the arena itself
+    if (m_backing == Backing::TransparentHuge) return std::min(m_capacity, anonHugePageBytes(m_base));
+#endif
+    return 0;
+}
+
+const char* Arena::backingName(Backing backing) {
+    switch (backing) {
+        case Backing::HugeTLB: return "hugetlb";
+        case Backing::TransparentHuge: return "thp";
+        case Backing::Normal: return "4k";
+        case Backing::Heap: return "heap";
+    }
+    return "unknown";
+}
+
+} // namespace kuzadesign
@@ -0,0 +1,96 @@
+#include "autotune.h"
+#include <algorithm>
+
+namespace kuzadesign {
+
+AutoTuner::AutoTuner(int minThreads, int maxThreads,
+                     const std::vector<PlacementPolicy>& placements, double margin)
+    : m_placements(placements), m_margin(margin) {
+    setThreadLimits(minThreads, maxThreads);
+}
+
+void AutoTuner::setThreadLimits(int minThreads, int maxThreads) {
+    m_minThreads = std::max(1, minThreads);
+    m_maxThreads = std::max(m_minThreads, maxThreads);
+}
+
+void AutoTuner::setIntensityRange(float minIntensity, float maxIntensity, float step) {
+    m_minIntensity = std::max(0.01f, minIntensity);
+    m_maxIntensity = std::max(m_minIntensity, maxIntensity);
+    m_intensityStep = step;
+}
+
+TuneSetting AutoTuner::next(const TuneSetting& current, double score) {
+    if (m_phase == Phase::Baseline) {
+        m_best = current;
+        m_baselineScore = score;
+
+        TuneSetting trial = perturb(current);
+        if (trial == current) {
+            // Nothing to try in this dimension (e.g. min == max threads)
+            advanceDimension();
+            trial = perturb(current);
+            if (trial == current) return current;
+        }
+        m_phase = Phase::Trial;
+        return trial;
+    }
+
+    // Trial window finished: keep it only if it clearly beat the baseline
+    m_phase = Phase::Baseline;
+    if (score > m_baselineScore * (1.0 + m_margin)) {
+        m_best = current;
+        return current;     // Keep climbing the same way next round
+    }
+
+    m_direction = -m_direction;
+    advanceDimension();
+    return m_best;
+}
+
+TuneSetting AutoTuner::perturb(const TuneSetting& from) {
+    TuneSetting trial = from;
+    trial.threads = std::min(std::max(trial.threads, m_minThreads), m_maxThreads);
+
+    if (m_dimension == Dimension::Threads) {
+        int step = trial.threads + m_direction;
+        if (step < m_minThreads || step > m_maxThreads) {
+            m_direction = -m_direction;
+            step = trial.threads + m_direction;
+        }
+        if (step >= m_minThreads && step <= m_maxThreads) trial.threads = step;
+        return trial;
+    }
+
+    if (m_dimension == Dimension::Intensity) {
+        float step = trial.intensity + m_direction * m_intensityStep;
+        if (step < m_minIntensity - 1e-4f || step > m_maxIntensity + 1e-4f) {
+            m_direction = -m_direction;
+            step = trial.intensity + m_direction * m_intensityStep;
+        }
+        trial.intensity = std::min(std::max(step, m_minIntensity), m_maxIntensity);
+        return trial;
+    }
+
+    if (m_placements.size() > 1) {
+        auto it = std::find(m_placements.begin(), m_placements.end(), from.placement);
+        size_t index = it == m_placements.end() ? 0 : (size_t)(it - m_placements.begin()) + 1;
+        trial.placement = m_placements[index % m_placements.size()];
+    }
+    return trial;
+}
+
+void AutoTuner::advanceDimension() {
+    bool placement = m_placements.size() > 1;
+    bool intensity = m_intensityStep > 0;
+
+    if (m_dimension == Dimension::Threads && placement) {
+        m_dimension = Dimension::Placement;
+    } else if (m_dimension != Dimension::Intensity && intensity) {
+        m_dimension = Dimension::Intensity;
+    } else {
+        m_dimension = Dimension::Threads;
+    }
+}
+
+} // namespace kuzadesign
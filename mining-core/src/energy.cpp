@@ -0,0 +1,51 @@
+#include "energy.h"
+#include <fstream>
+#include <cstdlib>
+
+namespace kuzadesign {
+
+static bool readFromDisk(const std::string& path, std::string& contents) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::getline(file, contents);
+    return true;
+}
+
+EnergyMeter::EnergyMeter(const std::string& powercapRoot, FileReader reader)
+    : m_reader(reader ? reader : FileReader(readFromDisk)) {
+    // Top-level zones are packages; intel-rapl:N:M subzones (core, dram)
+    // are already included in their package and are skipped.
+    for (int i = 0; i < 16; i++) {
+        std::string base = powercapRoot + "/intel-rapl:" + std::to_string(i);
+        Zone zone;
+        zone.energyPath = base + "/energy_uj";
+        if (!readCounter(zone.energyPath, zone.last)) break;
+        readCounter(base + "/max_energy_range_uj", zone.maxRange);
+        m_zones.push_back(zone);
+    }
+}
+
+bool EnergyMeter::readCounter(const std::string& path, uint64_t& value) const {
+    std::string contents;
+    if (!m_reader(path, contents) || contents.empty()) return false;
+    value = std::strtoull(contents.c_str(), nullptr, 10);
+    return true;
+}
+
+bool EnergyMeter::sample(double& joules) {
+    bool any = false;
+    for (auto& zone : m_zones) {
+        uint64_t now = 0;
+        if (!readCounter(zone.energyPath, now)) continue;
+
+        uint64_t delta = now >= zone.last ? now - zone.last
+                                          : (zone.maxRange > zone.last ? zone.maxRange - zone.last + now : now);
+        m_totalJoules += delta / 1e6;
+        zone.last = now;
+        any = true;
+    }
+    joules = m_totalJoules;
+    return any;
+}
+
+} // namespace kuzadesign
@@ -57,6 +57,18 @@ std::vector<uint8_t> calculateHash(const std::vector<uint8_t>& data, uint64_t no
     return output;
 }
 
+void calculateHash(const uint8_t* data, size_t len, uint8_t* out) {
+    blake3_hasher hasher;
+    blake3_hasher_init(&hasher);
+    blake3_hasher_update(&hasher, data, len);
+    blake3_hasher_finalize(&hasher, out, HASH_SIZE);
+}
+
+const char* hashKernelName() {
+    // Only blake3_portable.c is built; the SIMD back ends are not compiled in
+    return "blake3-portable";
+}
+
 bool checkDifficulty(const std::vector<uint8_t>& hash, const std::vector<uint8_t>& target) {
     if (hash.size() != target.size()) return false;
     
@@ -77,6 +89,14 @@ bool checkDifficulty(const std::vector<uint8_t>& hash, const std::vector<uint8_t
     return false; // Equal to target
 }
 
+bool checkDifficulty(const uint8_t* hash, const uint8_t* target, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        if (hash[i] < target[i]) return true;
+        if (hash[i] > target[i]) return false;
+    }
+    return false;
+}
+
 std::string hashToHex(const std::vector<uint8_t>& hash) {
     std::stringstream ss;
     for (uint8_t byte : hash) {
@@ -85,11 +105,24 @@ std::string hashToHex(const std::vector<uint8_t>& hash) {
     return ss.str();
 }
 
+static int hexDigit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
 std::vector<uint8_t> hexToBytes(const std::string& hex) {
+    // One byte per two-character group. A group whose first character is
+    // not a hex digit is 0; one whose second is not (or that is cut short)
+    // is the first digit alone. So "1z" is 0x01, "zz" is 0, "abc" is ab 0c.
     std::vector<uint8_t> bytes;
+    bytes.reserve((hex.length() + 1) / 2);
     for (size_t i = 0; i < hex.length(); i += 2) {
-        std::string byteString = hex.substr(i, 2);
-        uint8_t byte = (uint8_t)strtol(byteString.c_str(), NULL, 16);
+        int hi = hexDigit(hex[i]);
+        int lo = i + 1 < hex.length() ? hexDigit(hex[i + 1]) : -1;
+        uint8_t byte = 0;
+        if (hi >= 0) byte = (uint8_t)(lo >= 0 ? (hi << 4 | lo) : hi);
         bytes.push_back(byte);
     }
     return bytes;
@@ -0,0 +1,183 @@
+#include "instrument.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <new>
+
+#ifdef KZD_INSTRUMENTED
+extern "C" {
+#include "cJSON.h"
+}
+#ifdef _WIN32
+    #include <malloc.h>
+#endif
+#endif
+
+namespace kuzadesign {
+namespace instrument {
+
+namespace {
+
+std::atomic<uint64_t> lockContentions[(size_t)Lock::Count];
+LatencyHistogram lockWaits[(size_t)Lock::Count];
+
+std::atomic<uint64_t> allocationCounts[(size_t)Subsystem::Count];
+std::atomic<uint64_t> allocationBytes[(size_t)Subsystem::Count];
+
+thread_local Subsystem currentSubsystem = Subsystem::Core;
+
+} // namespace
+
+namespace detail {
+
+std::atomic<uint64_t> lockAcquisitions[(size_t)Lock::Count];
+
+void lockContended(std::mutex& mutex, Lock lock) {
+    auto start = std::chrono::steady_clock::now();
+    mutex.lock();
+    lockWaits[(size_t)lock].record(std::chrono::steady_clock::now() - start);
+    lockContentions[(size_t)lock].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Called from the replaced allocators; must not allocate itself
+inline void countAllocation(size_t size) {
+    size_t index = (size_t)currentSubsystem;
+    allocationCounts[index].fetch_add(1, std::memory_order_relaxed);
+    allocationBytes[index].fetch_add(size, std::memory_order_relaxed);
+}
+
+} // namespace detail
+
+const char* lockName(Lock lock) {
+    switch (lock) {
+        case Lock::Job: return "job";
+        case Lock::Send: return "send";
+        case Lock::Count: break;
+    }
+    return "unknown";
+}
+
+const char* subsystemName(Subsystem subsystem) {
+    switch (subsystem) {
+        case Subsystem::Core: return "core";
+        case Subsystem::Worker: return "worker";
+        case Subsystem::Network: return "network";
+        case Subsystem::Monitor: return "monitor";
+        case Subsystem::Stats: return "stats";
+        case Subsystem::Metrics: return "metrics";
+        case Subsystem::Count: break;
+    }
+    return "unknown";
+}
+
+LockStats lockStats(Lock lock) {
+    LockStats s;
+    s.acquisitions = detail::lockAcquisitions[(size_t)lock].load(std::memory_order_relaxed);
+    s.contended = lockContentions[(size_t)lock].load(std::memory_order_relaxed);
+    s.wait = summarize(lockWaits[(size_t)lock]);
+    return s;
+}
+
+const LatencyHistogram& lockWaitHistogram(Lock lock) {
+    return lockWaits[(size_t)lock];
+}
+
+AllocationStats allocationStats(Subsystem subsystem) {
+    AllocationStats s;
+    s.allocations = allocationCounts[(size_t)subsystem].load(std::memory_order_relaxed);
+    s.bytes = allocationBytes[(size_t)subsystem].load(std::memory_order_relaxed);
+    return s;
+}
+
+bool allocationTracking() {
+#ifdef KZD_INSTRUMENTED
+    return true;
+#else
+    return false;
+#endif
+}
+
+AllocationScope::AllocationScope(Subsystem subsystem) : m_saved(currentSubsystem) {
+    currentSubsystem = subsystem;
+}
+
+AllocationScope::~AllocationScope() {
+    currentSubsystem = m_saved;
+}
+
+#ifdef KZD_INSTRUMENTED
+namespace {
+
+void* countingMalloc(size_t size) {
+    detail::countAllocation(size);
+    return std::malloc(size);
+}
+
+// cJSON allocates through its own hooks rather than operator new
+struct InstallJsonHooks {
+    InstallJsonHooks() {
+        cJSON_Hooks hooks = { countingMalloc, std::free };
+        cJSON_InitHooks(&hooks);
+    }
+} installJsonHooks;
+
+} // namespace
+#endif
+
+} // namespace instrument
+} // namespace kuzadesign
+
+#ifdef KZD_INSTRUMENTED
+// Counting replacements for the global allocator (this object file is
+// always linked: InstrumentedMutex references it)
+void* operator new(size_t size) {
+    kuzadesign::instrument::detail::countAllocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    kuzadesign::instrument::detail::countAllocation(size);
+    void* p = std::malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete[](void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+void operator delete[](void* p, size_t) noexcept { std::free(p); }
+
+// new of any type whose alignment exceeds __STDCPP_DEFAULT_NEW_ALIGNMENT__
+// (e.g. a struct declared alignas(64), or std::vector of one) comes here.
+// Memory from these is released by the aligned deletes below, which on
+// Windows must use _aligned_free rather than free.
+static void* countedAlignedAlloc(size_t size, std::align_val_t align) {
+    kuzadesign::instrument::detail::countAllocation(size);
+    size_t alignment = std::max(sizeof(void*), (size_t)align);
+#ifdef _WIN32
+    void* p = _aligned_malloc(size ? size : 1, alignment);
+#else
+    void* p = nullptr;
+    if (posix_memalign(&p, alignment, size ? size : 1) != 0) p = nullptr;
+#endif
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+static void alignedFree(void* p) noexcept {
+#ifdef _WIN32
+    _aligned_free(p);
+#else
+    std::free(p);
+#endif
+}
+
+void* operator new(size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void* operator new[](size_t size, std::align_val_t align) { return countedAlignedAlloc(size, align); }
+void operator delete(void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete(void* p, size_t, std::align_val_t) noexcept { alignedFree(p); }
+void operator delete[](void* p, size_t, std::align_val_t) noexcept { alignedFree(p); }
+#endif
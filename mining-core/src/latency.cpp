@@ -0,0 +1,151 @@
+#include "latency.h"
+#include <cmath>
+
+namespace kuzadesign {
+
+namespace {
+
+constexpr uint64_t kSubBucketCount = 1ull << LatencyHistogram::kSubBucketBits;
+
+inline int highestBit(uint64_t v) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(v);
+#else
+    int bit = 0;
+    while (v >>= 1) bit++;
+    return bit;
+#endif
+}
+
+} // namespace
+
+LatencyHistogram::LatencyHistogram() {
+    reset();
+}
+
+size_t LatencyHistogram::bucketFor(uint64_t ns) {
+    if (ns < kSubBucketCount) return (size_t)ns;
+    int bit = highestBit(ns);
+    if (bit >= kMaxValueBits) return kBucketCount - 1;
+    int shift = bit - kSubBucketBits;
+    return (size_t)(shift + 1) * kSubBucketCount + (size_t)((ns >> shift) - kSubBucketCount);
+}
+
+uint64_t LatencyHistogram::highestEquivalent(size_t bucket) {
+    if (bucket < kSubBucketCount) return bucket;
+    int shift = (int)(bucket / kSubBucketCount) - 1;
+    uint64_t lowest = (kSubBucketCount + bucket % kSubBucketCount) << shift;
+    return lowest + (1ull << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    m_counts[bucketFor(ns)].fetch_add(1, std::memory_order_relaxed);
+    m_total.fetch_add(1, std::memory_order_relaxed);
+    m_sum.fetch_add(ns, std::memory_order_relaxed);
+    uint64_t seen = m_max.load(std::memory_order_relaxed);
+    while (ns > seen && !m_max.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+    }
+}
+
+void LatencyHistogram::record(std::chrono::steady_clock::duration elapsed) {
+    auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count();
+    record(ns > 0 ? (uint64_t)ns : 0);
+}
+
+uint64_t LatencyHistogram::count() const {
+    return m_total.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::max() const {
+    return m_max.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::sum() const {
+    return m_sum.load(std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::countAtOrBelow(uint64_t ns) const {
+    uint64_t n = 0;
+    for (size_t i = 0; i < kBucketCount && highestEquivalent(i) <= ns; i++) {
+        n += m_counts[i].load(std::memory_order_relaxed);
+    }
+    return n;
+}
+
+uint64_t LatencyHistogram::valueAtPercentile(double percentile) const {
+    uint64_t total = count();
+    if (total == 0) return 0;
+    if (percentile < 0.0) percentile = 0.0;
+    if (percentile > 100.0) percentile = 100.0;
+
+    // The epsilon keeps e.g. 99.9% of 1000 at rank 999 despite rounding.
+    // Counts can move while we walk; stop at the last non-empty bucket.
+    uint64_t rank = (uint64_t)std::ceil(percentile / 100.0 * total - 1e-9);
+    if (rank < 1) rank = 1;
+    uint64_t seen = 0;
+    uint64_t value = 0;
+    for (size_t i = 0; i < kBucketCount; i++) {
+        uint64_t n = m_counts[i].load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        seen += n;
+        value = highestEquivalent(i);
+        if (seen >= rank) break;
+    }
+    uint64_t top = max();
+    return value < top ? value : top;
+}
+
+void LatencyHistogram::reset() {
+    for (auto& c : m_counts) c.store(0, std::memory_order_relaxed);
+    m_total.store(0, std::memory_order_relaxed);
+    m_sum.store(0, std::memory_order_relaxed);
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+LatencySummary summarize(const LatencyHistogram& histogram) {
+    LatencySummary s;
+    s.count = histogram.count();
+    s.p50Us = histogram.valueAtPercentile(50.0) / 1000.0;
+    s.p99Us = histogram.valueAtPercentile(99.0) / 1000.0;
+    s.p999Us = histogram.valueAtPercentile(99.9) / 1000.0;
+    s.maxUs = histogram.max() / 1000.0;
+    return s;
+}
+
+namespace latency {
+
+namespace {
+LatencyHistogram stageHistograms[(size_t)Stage::Count];
+}
+
+const char* stageName(Stage stage) {
+    switch (stage) {
+        case Stage::ReadToHandled: return "readToHandled";
+        case Stage::NotifyToSetJob: return "notifyToSetJob";
+        case Stage::SetJobToFirstHash: return "setJobToFirstHash";
+        case Stage::CandidateToEnqueue: return "candidateToEnqueue";
+        case Stage::SubmitToAck: return "submitToAck";
+        case Stage::Count: break;
+    }
+    return "unknown";
+}
+
+void record(Stage stage, std::chrono::steady_clock::duration elapsed) {
+    stageHistograms[(size_t)stage].record(elapsed);
+}
+
+LatencyHistogram& histogram(Stage stage) {
+    return stageHistograms[(size_t)stage];
+}
+
+LatencySummary summary(Stage stage) {
+    return summarize(stageHistograms[(size_t)stage]);
+}
+
+void resetAll() {
+    for (auto& h : stageHistograms) h.reset();
+}
+
+} // namespace latency
+
+} // namespace kuzadesign
@@ -0,0 +1,252 @@
+#include "log.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdarg>
+#include <cstdio>
+#include <mutex>
+#include <thread>
+
+namespace kuzadesign {
+namespace logging {
+
+namespace {
+
+constexpr size_t kCapacity = 512;           // Power of two
+constexpr size_t kMaxLine = 512;            // Longer messages are truncated
+
+// Bounded MPMC ring (Vyukov) used with a single consumer. A slot's
+// sequence says who may touch it next: producer of position p when it
+// equals p, consumer when it equals p + 1. Sequences are stored minus the
+// slot index so the zero-initialised array starts out valid without a
+// static constructor.
+struct Slot {
+    std::atomic<uint64_t> seq;
+    Level level;
+    char text[kMaxLine];
+};
+
+Slot slots[kCapacity];
+std::atomic<uint64_t> enqueuePos{0};
+std::atomic<uint64_t> dequeuePos{0};
+
+inline uint64_t slotSeq(size_t index) {
+    return slots[index].seq.load(std::memory_order_acquire) + index;
+}
+inline void setSlotSeq(size_t index, uint64_t seq) {
+    slots[index].seq.store(seq - index, std::memory_order_release);
+}
+
+std::atomic<int> currentLevel{(int)Level::Info};
+std::atomic<uint32_t> rateLimit{200};
+std::atomic<int64_t> rateWindow{-1};
+std::atomic<uint32_t> rateCount{0};
+
+std::atomic<uint64_t> writtenCount{0};
+std::atomic<uint64_t> suppressedCount{0};
+std::atomic<uint64_t> droppedCount{0};
+uint64_t reportedSuppressed = 0;            // Writer thread only
+uint64_t reportedDropped = 0;
+
+std::mutex wakeMutex;
+std::condition_variable wakeCv;
+std::once_flag startOnce;
+std::atomic<bool> shutDown{false};
+
+FILE* streamFor(Level level) {
+    return level >= Level::Warn ? stderr : stdout;
+}
+
+size_t drain() {
+    size_t n = 0;
+    FILE* last = nullptr;
+    for (;;) {
+        uint64_t pos = dequeuePos.load(std::memory_order_relaxed);
+        size_t index = (size_t)(pos & (kCapacity - 1));
+        if (slotSeq(index) != pos + 1) break;
+        // Keep stdout and stderr lines in order when both go to one terminal
+        FILE* out = streamFor(slots[index].level);
+        if (last && out != last) std::fflush(last);
+        last = out;
+        std::fputs(slots[index].text, out);
+        std::fputc('\n', out);
+        setSlotSeq(index, pos + kCapacity);
+        writtenCount.fetch_add(1, std::memory_order_relaxed);
+        dequeuePos.store(pos + 1, std::memory_order_release);
+        n++;
+    }
+
+    uint64_t suppressed = suppressedCount.load(std::memory_order_relaxed);
+    uint64_t dropped = droppedCount.load(std::memory_order_relaxed);
+    if (suppressed != reportedSuppressed || dropped != reportedDropped) {
+        std::fflush(stdout);
+        std::fprintf(stderr, "[log] %llu message(s) over the rate limit, %llu dropped (queue full)\n",
+                     (unsigned long long)(suppressed - reportedSuppressed),
+                     (unsigned long long)(dropped - reportedDropped));
+        reportedSuppressed = suppressed;
+        reportedDropped = dropped;
+    }
+    if (n) {
+        std::fflush(stdout);
+        std::fflush(stderr);
+    }
+    return n;
+}
+
+void writerLoop() {
+    for (;;) {
+        bool stopping = shutDown.load();
+        size_t n = drain();
+        if (stopping && n == 0) break;
+        if (n == 0) {
+            // Warnings and a half-full ring wake us at once; anything else
+            // is written within 50 ms
+            std::unique_lock<std::mutex> lock(wakeMutex);
+            wakeCv.wait_for(lock, std::chrono::milliseconds(50));
+        }
+    }
+}
+
+// Owns the writer thread; drains and joins it at exit. Declared after the
+// mutex and condition variable so it is destroyed before them.
+struct Writer {
+    std::thread thread;
+    ~Writer() {
+        shutDown = true;
+        wakeCv.notify_one();
+        if (thread.joinable()) thread.join();
+    }
+};
+Writer writer;
+
+void startWriter() {
+    writer.thread = std::thread(writerLoop);
+}
+
+bool admit() {
+    uint32_t limit = rateLimit.load(std::memory_order_relaxed);
+    if (limit == 0) return true;
+    int64_t second = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    int64_t window = rateWindow.load(std::memory_order_relaxed);
+    if (window != second && rateWindow.compare_exchange_strong(window, second)) {
+        rateCount.store(0, std::memory_order_relaxed);
+    }
+    return rateCount.fetch_add(1, std::memory_order_relaxed) < limit;
+}
+
+// Status lines skip the level filter and the rate limit
+void vwrite(Level level, bool isStatus, const char* format, va_list args) {
+    if (isStatus ? logging::level() == Level::Off : !enabled(level)) return;
+    if (!isStatus && level < Level::Error && !admit()) {
+        suppressedCount.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    // Late messages from static destructors are written directly
+    if (shutDown.load(std::memory_order_relaxed)) {
+        std::vfprintf(streamFor(level), format, args);
+        std::fputc('\n', streamFor(level));
+        return;
+    }
+    std::call_once(startOnce, startWriter);
+
+    uint64_t pos = enqueuePos.load(std::memory_order_relaxed);
+    size_t index;
+    for (;;) {
+        index = (size_t)(pos & (kCapacity - 1));
+        int64_t diff = (int64_t)(slotSeq(index) - pos);
+        if (diff == 0) {
+            if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            droppedCount.fetch_add(1, std::memory_order_relaxed);
+            return;
+        } else {
+            pos = enqueuePos.load(std::memory_order_relaxed);
+        }
+    }
+
+    std::vsnprintf(slots[index].text, kMaxLine, format, args);
+    slots[index].level = level;
+    setSlotSeq(index, pos + 1);
+
+    if (level >= Level::Warn || pos + 1 - dequeuePos.load(std::memory_order_relaxed) >= kCapacity / 2) {
+        wakeCv.notify_one();
+    }
+}
+
+} // namespace
+
+const char* levelName(Level level) {
+    switch (level) {
+        case Level::Debug: return "debug";
+        case Level::Info: return "info";
+        case Level::Warn: return "warn";
+        case Level::Error: return "error";
+        case Level::Off: return "off";
+    }
+    return "info";
+}
+
+bool parseLevel(const std::string& name, Level& level) {
+    for (Level candidate : { Level::Debug, Level::Info, Level::Warn, Level::Error, Level::Off }) {
+        if (name == levelName(candidate)) {
+            level = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void setLevel(Level level) {
+    currentLevel.store((int)level, std::memory_order_relaxed);
+}
+
+Level level() {
+    return (Level)currentLevel.load(std::memory_order_relaxed);
+}
+
+void setRateLimit(uint32_t linesPerSecond) {
+    rateLimit.store(linesPerSecond, std::memory_order_relaxed);
+}
+
+void write(Level level, const char* format, ...) {
+    va_list args;
+    va_start(args, format);
+    vwrite(level, false, format, args);
+    va_end(args);
+}
+
+#define KZD_LOG_AT(lvl, isStatus)               \
+    va_list args;                               \
+    va_start(args, format);                     \
+    vwrite(lvl, isStatus, format, args);        \
+    va_end(args)
+
+void debug(const char* format, ...) { KZD_LOG_AT(Level::Debug, false); }
+void info(const char* format, ...) { KZD_LOG_AT(Level::Info, false); }
+void warn(const char* format, ...) { KZD_LOG_AT(Level::Warn, false); }
+void error(const char* format, ...) { KZD_LOG_AT(Level::Error, false); }
+void status(const char* format, ...) { KZD_LOG_AT(Level::Info, true); }
+
+#undef KZD_LOG_AT
+
+void flush() {
+    uint64_t target = enqueuePos.load(std::memory_order_acquire);
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(500);
+    wakeCv.notify_one();
+    while (dequeuePos.load(std::memory_order_acquire) < target && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+Counters counters() {
+    Counters c;
+    c.written = writtenCount.load(std::memory_order_relaxed);
+    c.suppressed = suppressedCount.load(std::memory_order_relaxed);
+    c.dropped = droppedCount.load(std::memory_order_relaxed);
+    return c;
+}
+
+} // namespace logging
+} // namespace kuzadesign
@@ -0,0 +1,335 @@
+#include "metrics.h"
+#include "cycles.h"
+#include "hash.h"
+#include "instrument.h"
+#include "latency.h"
+#include "log.h"
+#include <cstdio>
+#include <cstring>
+#include <sstream>
+
+#ifndef _WIN32
+    #include <netinet/in.h>
+    #include <sys/select.h>
+#endif
+
+namespace kuzadesign {
+
+namespace {
+
+// Upper bounds of the exported latency buckets, in seconds; the HDR
+// histograms behind them are much finer
+const double kLatencyBucketsSec[] = { 1e-5, 5e-5, 1e-4, 5e-4, 1e-3, 5e-3, 1e-2, 5e-2, 1e-1, 5e-1, 1.0, 5.0 };
+
+std::string number(double value) {
+    char buf[32];
+    std::snprintf(buf, sizeof(buf), "%.9g", value);
+    return buf;
+}
+
+std::string number(uint64_t value) {
+    return std::to_string(value);
+}
+
+std::string escapeLabel(const std::string& value) {
+    std::string out;
+    for (char ch : value) {
+        if (ch == '\\' || ch == '"') out += '\\';
+        if (ch == '\n') { out += "\\n"; continue; }
+        out += ch;
+    }
+    return out;
+}
+
+void family(std::ostringstream& out, const char* name, const char* type, const char* help) {
+    out << "# TYPE " << name << " " << type << "\n";
+    out << "# HELP " << name << " " << help << "\n";
+}
+
+void closeSocket(socket_t fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+} // namespace
+
+std::string renderOpenMetrics(const MiningStats& stats, const MetricsInfo& info) {
+    std::ostringstream out;
+
+    family(out, "kzd_build", "info", "Hash kernel and cycle counter of this build");
+    out << "kzd_build_info{kernel=\"" << escapeLabel(hashKernelName())
+        << "\",cycle_counter=\"" << cycleCounterName() << "\"} 1\n";
+
+    family(out, "kzd_pool_connected", "gauge", "1 while connected to the pool");
+    out << "kzd_pool_connected " << (info.connected ? 1 : 0) << "\n";
+
+    family(out, "kzd_uptime_seconds", "gauge", "Seconds since mining started");
+    out << "kzd_uptime_seconds " << number(stats.uptime) << "\n";
+
+    family(out, "kzd_hashrate_hashes_per_second", "gauge", "Hashrate since start and over trailing windows");
+    out << "kzd_hashrate_hashes_per_second{window=\"total\"} " << number(stats.hashrate) << "\n";
+    out << "kzd_hashrate_hashes_per_second{window=\"10s\"} " << number(stats.hashrate10s) << "\n";
+    out << "kzd_hashrate_hashes_per_second{window=\"60s\"} " << number(stats.hashrate60s) << "\n";
+    out << "kzd_hashrate_hashes_per_second{window=\"15m\"} " << number(stats.hashrate15m) << "\n";
+
+    family(out, "kzd_shares_found", "counter", "Hashes under the job target found by the workers");
+    out << "kzd_shares_found_total " << number(stats.sharesAccepted) << "\n";
+    family(out, "kzd_shares_submitted", "counter", "Shares written to the pool");
+    out << "kzd_shares_submitted_total " << number(info.shares.submitted) << "\n";
+    family(out, "kzd_shares", "counter", "Pool verdicts on submitted shares");
+    out << "kzd_shares_total{result=\"accepted\"} " << number(info.shares.accepted) << "\n";
+    out << "kzd_shares_total{result=\"rejected\"} " << number(info.shares.rejected) << "\n";
+    out << "kzd_shares_total{result=\"stale\"} " << number(info.shares.stale) << "\n";
+
+    family(out, "kzd_threads", "gauge", "Running hashing workers");
+    out << "kzd_threads " << stats.workers.size() << "\n";
+    family(out, "kzd_duty_cycle_ratio", "gauge", "Achieved hashing duty cycle across workers");
+    out << "kzd_duty_cycle_ratio " << number((double)stats.dutyCycle) << "\n";
+    family(out, "kzd_thermal_scale_ratio", "gauge", "Thermal governor output (1 = unthrottled)");
+    out << "kzd_thermal_scale_ratio " << number((double)stats.thermalScale) << "\n";
+    family(out, "kzd_foreground_scale_ratio", "gauge", "Foreground back-off output (1 = not backing off)");
+    out << "kzd_foreground_scale_ratio " << number((double)stats.foregroundScale) << "\n";
+    family(out, "kzd_cpu_temperature_celsius", "gauge", "CPU temperature (0 when unknown)");
+    out << "kzd_cpu_temperature_celsius " << number((double)stats.cpuTemp) << "\n";
+    family(out, "kzd_cpu_usage_percent", "gauge", "Busy share of all CPUs");
+    out << "kzd_cpu_usage_percent " << number((double)stats.cpuUsage) << "\n";
+    family(out, "kzd_steal_percent", "gauge", "Hypervisor steal time");
+    out << "kzd_steal_percent " << number((double)stats.stealPercent) << "\n";
+
+    family(out, "kzd_worker_hashes", "counter", "Hashes computed per worker");
+    for (const auto& w : stats.workers) {
+        out << "kzd_worker_hashes_total{worker=\"" << w.threadId << "\"} " << number(w.hashes) << "\n";
+    }
+    family(out, "kzd_worker_busy_seconds", "counter", "Wall time each worker spent hashing");
+    for (const auto& w : stats.workers) {
+        out << "kzd_worker_busy_seconds_total{worker=\"" << w.threadId << "\"} " << number(w.busyNs / 1e9) << "\n";
+    }
+    family(out, "kzd_worker_idle_seconds", "counter", "Wall time each worker spent in duty-cycle sleeps");
+    for (const auto& w : stats.workers) {
+        out << "kzd_worker_idle_seconds_total{worker=\"" << w.threadId << "\"} " << number(w.idleNs / 1e9) << "\n";
+    }
+    family(out, "kzd_worker_cpu_seconds", "counter", "Thread CPU time each worker got while hashing");
+    for (const auto& w : stats.workers) {
+        out << "kzd_worker_cpu_seconds_total{worker=\"" << w.threadId << "\"} " << number(w.cpuNs / 1e9) << "\n";
+    }
+    family(out, "kzd_worker_batch_size", "gauge", "Calibrated hashes per inner batch");
+    for (const auto& w : stats.workers) {
+        out << "kzd_worker_batch_size{worker=\"" << w.threadId << "\"} " << w.batchSize << "\n";
+    }
+    if (stats.cycleAccounting) {
+        family(out, "kzd_worker_cycles", "counter", "Worker cycle counter ticks by activity");
+        for (const auto& w : stats.workers) {
+            const std::pair<const char*, uint64_t> buckets[] = {
+                { "hash", w.cycles.hash }, { "target_check", w.cycles.targetCheck },
+                { "job_check", w.cycles.jobCheck }, { "share", w.cycles.share },
+                { "idle", w.cycles.idle }, { "other", w.cycles.other },
+            };
+            for (const auto& bucket : buckets) {
+                out << "kzd_worker_cycles_total{worker=\"" << w.threadId << "\",activity=\"" << bucket.first
+                    << "\"} " << number(bucket.second) << "\n";
+            }
+        }
+    }
+
+    family(out, "kzd_stage_latency_seconds", "histogram", "Share pipeline stage latencies");
+    for (int i = 0; i < (int)latency::Stage::Count; i++) {
+        latency::Stage stage = (latency::Stage)i;
+        const LatencyHistogram& h = latency::histogram(stage);
+        const char* name = latency::stageName(stage);
+        for (double le : kLatencyBucketsSec) {
+            out << "kzd_stage_latency_seconds_bucket{stage=\"" << name << "\",le=\"" << number(le) << "\"} "
+                << number(h.countAtOrBelow((uint64_t)(le * 1e9))) << "\n";
+        }
+        uint64_t count = h.count();
+        out << "kzd_stage_latency_seconds_bucket{stage=\"" << name << "\",le=\"+Inf\"} " << number(count) << "\n";
+        out << "kzd_stage_latency_seconds_count{stage=\"" << name << "\"} " << number(count) << "\n";
+        out << "kzd_stage_latency_seconds_sum{stage=\"" << name << "\"} " << number(h.sum() / 1e9) << "\n";
+    }
+
+    family(out, "kzd_lock_acquisitions", "counter", "Mutex acquisitions");
+    for (int i = 0; i < (int)instrument::Lock::Count; i++) {
+        out << "kzd_lock_acquisitions_total{lock=\"" << instrument::lockName((instrument::Lock)i) << "\"} "
+            << number(instrument::lockStats((instrument::Lock)i).acquisitions) << "\n";
+    }
+    family(out, "kzd_lock_wait_seconds", "histogram", "Time spent waiting for a contended mutex");
+    for (int i = 0; i < (int)instrument::Lock::Count; i++) {
+        const LatencyHistogram& h = instrument::lockWaitHistogram((instrument::Lock)i);
+        const char* name = instrument::lockName((instrument::Lock)i);
+        for (double le : kLatencyBucketsSec) {
+            out << "kzd_lock_wait_seconds_bucket{lock=\"" << name << "\",le=\"" << number(le) << "\"} "
+                << number(h.countAtOrBelow((uint64_t)(le * 1e9))) << "\n";
+        }
+        uint64_t count = h.count();
+        out << "kzd_lock_wait_seconds_bucket{lock=\"" << name << "\",le=\"+Inf\"} " << number(count) << "\n";
+        out << "kzd_lock_wait_seconds_count{lock=\"" << name << "\"} " << number(count) << "\n";
+        out << "kzd_lock_wait_seconds_sum{lock=\"" << name << "\"} " << number(h.sum() / 1e9) << "\n";
+    }
+
+    if (stats.allocationTracking) {
+        family(out, "kzd_allocations", "counter", "Heap allocations by subsystem (instrumented builds)");
+        for (int i = 0; i < (int)instrument::Subsystem::Count; i++) {
+            out << "kzd_allocations_total{subsystem=\"" << instrument::subsystemName((instrument::Subsystem)i)
+                << "\"} " << number(stats.allocations[i].allocations) << "\n";
+        }
+        family(out, "kzd_allocated_bytes", "counter", "Heap bytes allocated by subsystem (instrumented builds)");
+        for (int i = 0; i < (int)instrument::Subsystem::Count; i++) {
+            out << "kzd_allocated_bytes_total{subsystem=\"" << instrument::subsystemName((instrument::Subsystem)i)
+                << "\"} " << number(stats.allocations[i].bytes) << "\n";
+        }
+    }
+
+    out << "# EOF\n";
+    return out.str();
+}
+
+MetricsServer::MetricsServer() : m_listenFd(INVALID_SOCKET_VAL) {
+#ifdef _WIN32
+    WSADATA wsaData;
+    WSAStartup(MAKEWORD(2, 2), &wsaData);
+#endif
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+#ifdef _WIN32
+    WSACleanup();
+#endif
+}
+
+bool MetricsServer::start(const std::string& bindAddress, int port, Provider provider, int minRefreshMs) {
+    if (m_running) return false;
+
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr(bindAddress.c_str());
+    if (addr.sin_addr.s_addr == INADDR_NONE && bindAddress != "255.255.255.255") {
+        logging::error("Metrics: invalid bind address %s", bindAddress.c_str());
+        return false;
+    }
+
+    m_listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (m_listenFd == INVALID_SOCKET_VAL) {
+        logging::error("Metrics: could not create socket");
+        return false;
+    }
+    int reuse = 1;
+    setsockopt(m_listenFd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+    if (bind(m_listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(m_listenFd, 8) != 0) {
+        logging::error("Metrics: could not listen on %s:%d", bindAddress.c_str(), port);
+        closeSocket(m_listenFd);
+        m_listenFd = INVALID_SOCKET_VAL;
+        return false;
+    }
+
+    socklen_t len = sizeof(addr);
+    getsockname(m_listenFd, (struct sockaddr*)&addr, &len);
+    m_port = ntohs(addr.sin_port);
+
+    m_provider = provider;
+    m_minRefresh = std::chrono::milliseconds(minRefreshMs > 0 ? minRefreshMs : 0);
+    m_cachedBody.clear();
+    m_running = true;
+    m_thread = std::thread(&MetricsServer::serve, this);
+    return true;
+}
+
+void MetricsServer::stop() {
+    if (!m_running.exchange(false)) return;
+    if (m_thread.joinable()) m_thread.join();
+    closeSocket(m_listenFd);
+    m_listenFd = INVALID_SOCKET_VAL;
+}
+
+bool MetricsServer::isRunning() const {
+    return m_running;
+}
+
+int MetricsServer::port() const {
+    return m_port;
+}
+
+std::string MetricsServer::body() {
+    auto now = std::chrono::steady_clock::now();
+    if (m_cachedBody.empty() || now - m_cachedAt >= m_minRefresh) {
+        m_cachedBody = m_provider ? m_provider() : std::string("# EOF\n");
+        m_cachedAt = now;
+    }
+    return m_cachedBody;
+}
+
+void MetricsServer::serve() {
+    instrument::AllocationScope allocScope(instrument::Subsystem::Metrics);
+    while (m_running) {
+        // Wake up regularly so stop() never waits on a silent socket
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(m_listenFd, &readable);
+        struct timeval timeout = { 0, 200000 };
+        int ready = select((int)m_listenFd + 1, &readable, nullptr, nullptr, &timeout);
+        if (ready <= 0) continue;
+
+        socket_t fd = accept(m_listenFd, nullptr, nullptr);
+        if (fd == INVALID_SOCKET_VAL) continue;
+        handleConnection(fd);
+        closeSocket(fd);
+    }
+}
+
+void MetricsServer::handleConnection(socket_t fd) {
+    // One request per connection; a client that never finishes its headers
+    // gets cut off by the receive timeout
+#ifdef _WIN32
+    DWORD timeoutMs = 1000;
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, (const char*)&timeoutMs, sizeof(timeoutMs));
+#else
+    struct timeval timeout = { 1, 0 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+#endif
+
+    std::string request;
+    char buffer[1024];
+    while (request.find("\r\n\r\n") == std::string::npos && request.size() < 8192) {
+        ssize_t_compat n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        request.append(buffer, (size_t)n);
+    }
+
+    std::string status = "200 OK";
+    std::string contentType = "application/openmetrics-text; version=1.0.0; charset=utf-8";
+    std::string content;
+    std::string target = request.substr(0, request.find("\r\n"));
+    if (target.compare(0, 4, "GET ") != 0) {
+        status = "405 Method Not Allowed";
+        contentType = "text/plain";
+        content = "Only GET is supported\n";
+    } else if (target.compare(4, 9, "/metrics ") == 0 || target.compare(4, 9, "/metrics?") == 0) {
+        content = body();
+    } else {
+        status = "404 Not Found";
+        contentType = "text/plain";
+        content = "Metrics are served at /metrics\n";
+    }
+
+    std::string response = "HTTP/1.0 " + status + "\r\nContent-Type: " + contentType +
+                           "\r\nContent-Length: " + std::to_string(content.size()) +
+                           "\r\nConnection: close\r\n\r\n" + content;
+    // A scraper hanging up early must not raise SIGPIPE in the miner
+    int flags = 0;
+#ifdef MSG_NOSIGNAL
+    flags = MSG_NOSIGNAL;
+#endif
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t_compat n = send(fd, response.c_str() + sent, (int)(response.size() - sent), flags);
+        if (n <= 0) break;
+        sent += (size_t)n;
+    }
+}
+
+} // namespace kuzadesign
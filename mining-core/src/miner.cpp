@@ -1,11 +1,23 @@
 #include "miner.h"
 #include "hash.h"
+#include "arena.h"
+#include "monitor.h"
+#include "energy.h"
+#include "trace.h"
+#include "latency.h"
+#include "cycles.h"
+#include "log.h"
 #include <chrono>
-#include <iostream>
 #include <cstring>
 #include <vector>
 #include <thread>
 #include <mutex>
+#include <algorithm>
+#include <cmath>
+
+#ifdef __linux__
+    #include <sys/prctl.h>
+#endif
 
 namespace kuzadesign {
 
@@ -22,17 +34,73 @@ bool Miner::start(const MiningConfig& config) {
     }
 
     running = true;
+    m_config = config;
+    if (config.efficiencyMode) m_config.autotune = true;
     stats = MiningStats();
     m_totalHashes = 0;
     m_sharesAccepted = 0;
     m_startTime = std::chrono::steady_clock::now();
+    m_tuneEpoch++;
+    setIntensity(config.intensity);
+    m_thermalScale = 1.0f;
+    m_stealShed = 0;
+    m_tunedThreads = 0;
+    m_requestedThreads = config.numThreads;
+    m_steal = 0.0f;
+    m_workerEfficiency = 1.0f;
+    m_powerWatts = 0.0;
+    m_hashesPerJoule = 0.0;
+    m_energyJoules = 0.0;
+    m_cpuPressure = 0.0f;
+    m_foregroundScale = 1.0f;
+    refreshUsableCpus();
+    m_cpuTemp = 0.0f;
+    m_cpuUsage = 0.0f;
+
+    {
+        std::lock_guard<std::mutex> lock(leaseMutex);
+        m_nextLease = 0;
+        m_returnedLeases.clear();
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(samplesMutex);
+        m_hashSamples.clear();
+    }
+
+    {
+        std::lock_guard<InstrumentedMutex> lock(jobMutex);
+        m_jobDispatchNs = 0;
+        m_dispatchedJobs = 0;
+        m_dispatchSumUs = 0.0;
+        m_dispatchMaxUs = 0.0;
+    }
+    latency::resetAll();
+
+    m_topology = CpuTopology::discover();
+    m_placement = config.placement;
+    // Unpinned workers keep the affinity we were started with, minus the
+    // network CPU; never every online CPU
+    m_workerCpus = affinityCpus();
+    m_workerCpus.erase(std::remove(m_workerCpus.begin(), m_workerCpus.end(), config.reservedCpu),
+                       m_workerCpus.end());
+    m_placementCpus = placementCpus(config.placement);
+    if (config.placement != PlacementPolicy::None && m_placementCpus.empty()) {
+        logging::warn("Placement '%s' matched no CPUs, workers will not be pinned",
+                      placementPolicyName(config.placement));
+    }
 
     // Create worker threads
-    for (int i = 0; i < config.numThreads; i++) {
-        workers.emplace_back(&Miner::workerThread, this, i);
+    {
+        std::lock_guard<std::mutex> lock(workersMutex);
+        for (int i = 0, n = targetThreadCount(); i < n; i++) {
+            spawnWorker(i);
+        }
     }
 
-    std::cout << "Mining started with " << config.numThreads << " threads" << std::endl;
+    m_monitorThread = std::thread(&Miner::monitorThread, this);
+
+    logging::info("Mining started with %d threads%s", (int)workers.size(), config.numThreads > 0 ? "" : " (auto)");
     return true;
 }
 
@@ -41,35 +109,255 @@ void Miner::stop() {
         return;
     }
 
-    running = false;
+    {
+        std::lock_guard<std::mutex> lock(monitorMutex);
+        running = false;
+    }
+    monitorCv.notify_all();
+    {
+        // Wake workers still waiting for their first job
+        std::lock_guard<InstrumentedMutex> lock(jobMutex);
+        jobCv.notify_all();
+    }
+    if (m_monitorThread.joinable()) {
+        m_monitorThread.join();
+    }
     
     // Wait for workers to finish
+    std::lock_guard<std::mutex> lock(workersMutex);
     for (auto& worker : workers) {
-        if (worker.joinable()) {
-            worker.join();
+        if (worker->thread.joinable()) {
+            worker->thread.join();
         }
     }
     
     workers.clear();
-    std::cout << "Mining stopped" << std::endl;
+    logging::info("Mining stopped");
 }
 
 bool Miner::isRunning() const {
     return running;
 }
 
+// Placement CPUs for a policy, minus the reserved network CPU
+std::vector<int> Miner::placementCpus(PlacementPolicy policy) const {
+    std::vector<int> cpus = m_topology.placement(policy, m_config.numaNode);
+    cpus.erase(std::remove(cpus.begin(), cpus.end(), m_config.reservedCpu), cpus.end());
+    return cpus;
+}
+
+void Miner::assignCpu(WorkerContext* ctx) {
+    int cpu = -1;
+    if (!m_placementCpus.empty()) {
+        cpu = m_placementCpus[ctx->id % m_placementCpus.size()];
+    }
+    ctx->node = cpu >= 0 ? m_topology.nodeOf(cpu) : -1;
+    ctx->cpu = cpu;
+}
+
+// Caller holds workersMutex
+void Miner::spawnWorker(int id) {
+    auto ctx = std::make_unique<WorkerContext>();
+    ctx->id = id;
+    assignCpu(ctx.get());
+    ctx->thread = std::thread(&Miner::workerThread, this, ctx.get());
+    workers.push_back(std::move(ctx));
+}
+
+bool Miner::setThreadCount(int n) {
+    if (n < 0) return false;
+    if (n == 0) refreshUsableCpus();
+
+    // Stopped: start() takes the count from its config, so this would be lost
+    std::lock_guard<std::mutex> lock(workersMutex);
+    if (!running) return false;
+    m_requestedThreads = n;
+    resizeWorkers(targetThreadCount());
+    return true;
+}
+
+// Requested thread count after governors have had their say
+int Miner::targetThreadCount() const {
+    int requested = m_requestedThreads.load();
+    int n = requested > 0 ? requested : m_usableCpus.load();
+    if (m_tunedThreads.load() > 0) {
+        n = m_tunedThreads.load();
+    }
+    if (m_config.throttleThreads) {
+        n = (int)std::ceil(n * m_thermalScale.load());
+    }
+    n -= m_stealShed.load();
+    return std::max(1, n);
+}
+
+// Caller holds workersMutex
+void Miner::resizeWorkers(int n) {
+    int current = (int)workers.size();
+    if (n == current) return;
+
+    if (n > current) {
+        for (int i = current; i < n; i++) {
+            spawnWorker(i);
+        }
+    } else {
+        // Retire the highest ids first; each finishes its batch, returns its
+        // nonce lease and exits while the remaining workers keep hashing.
+        for (int i = n; i < current; i++) {
+            workers[i]->retire = true;
+        }
+        {
+            std::lock_guard<InstrumentedMutex> lock(jobMutex);
+            jobCv.notify_all();
+        }
+        for (int i = n; i < current; i++) {
+            if (workers[i]->thread.joinable()) {
+                workers[i]->thread.join();
+            }
+        }
+        workers.resize(n);
+    }
+
+    // Per-core throughput changes with the thread count
+    m_tuneEpoch++;
+    logging::info("Mining resized from %d to %d threads", current, n);
+}
+
+void Miner::setPlacement(PlacementPolicy policy) {
+    std::lock_guard<std::mutex> lock(workersMutex);
+    m_placement = policy;
+    m_placementCpus = placementCpus(policy);
+    for (auto& worker : workers) {
+        assignCpu(worker.get());
+    }
+    m_tuneEpoch++;
+}
+
+int Miner::getThreadCount() const {
+    std::lock_guard<std::mutex> lock(workersMutex);
+    return running ? (int)workers.size() : m_requestedThreads.load();
+}
+
+// Leases are large enough that a worker practically never exhausts one on
+// a single job, but a retired worker's remainder is still handed out again.
+static constexpr uint64_t kNonceLeaseSize = 1ULL << 32;
+
+Miner::NonceLease Miner::acquireLease() {
+    std::lock_guard<std::mutex> lock(leaseMutex);
+    if (!m_returnedLeases.empty()) {
+        NonceLease lease = m_returnedLeases.back();
+        m_returnedLeases.pop_back();
+        return lease;
+    }
+    NonceLease lease;
+    lease.next = m_nextLease;
+    lease.end = m_nextLease + kNonceLeaseSize;
+    m_nextLease = lease.end;
+    return lease;
+}
+
+void Miner::releaseLease(const NonceLease& lease) {
+    if (lease.next >= lease.end) return;
+    std::lock_guard<std::mutex> lock(leaseMutex);
+    m_returnedLeases.push_back(lease);
+}
+
 MiningStats Miner::getStats() const {
+    instrument::AllocationScope allocScope(instrument::Subsystem::Stats);
+    std::lock_guard<std::mutex> lock(workersMutex);
     MiningStats s = stats;
     s.sharesAccepted = m_sharesAccepted.load();
+    s.cpuTemp = m_cpuTemp.load();
+    s.cpuUsage = m_cpuUsage.load();
+    s.thermalScale = m_thermalScale.load();
+    s.usableCpus = m_usableCpus.load();
+    s.cpuQuota = m_cpuQuota.load();
+    s.stealPercent = m_steal.load();
+    s.workerEfficiency = m_workerEfficiency.load();
+    s.stealShedThreads = m_stealShed.load();
+    s.tunedThreads = m_tunedThreads.load();
+    s.placement = m_placement.load();
+    s.powerWatts = m_powerWatts.load();
+    s.hashesPerJoule = m_hashesPerJoule.load();
+    s.energyJoules = m_energyJoules.load();
+    s.cpuPressure = m_cpuPressure.load();
+    s.foregroundScale = m_foregroundScale.load();
+    s.reservedCpu = m_config.reservedCpu;
+    s.cycleAccounting = m_config.cycleAccounting;
+    {
+        std::lock_guard<InstrumentedMutex> jobLock(jobMutex);
+        s.notifyLatencyUs = m_jobDispatchNs / 1000.0;
+        s.notifyLatencyAvgUs = m_dispatchedJobs ? m_dispatchSumUs / m_dispatchedJobs : 0.0;
+        s.notifyLatencyMaxUs = m_dispatchMaxUs;
+    }
+    s.readToHandled = latency::summary(latency::Stage::ReadToHandled);
+    s.notifyToSetJob = latency::summary(latency::Stage::NotifyToSetJob);
+    s.setJobToFirstHash = latency::summary(latency::Stage::SetJobToFirstHash);
+    s.candidateToEnqueue = latency::summary(latency::Stage::CandidateToEnqueue);
+    s.submitToAck = latency::summary(latency::Stage::SubmitToAck);
+    s.jobLock = instrument::lockStats(instrument::Lock::Job);
+    s.sendLock = instrument::lockStats(instrument::Lock::Send);
+    s.allocationTracking = instrument::allocationTracking();
+    for (size_t i = 0; i < (size_t)instrument::Subsystem::Count; i++) {
+        s.allocations[i] = instrument::allocationStats((instrument::Subsystem)i);
+    }
+    s.hashrate10s = windowedHashrate(std::chrono::seconds(10));
+    s.hashrate60s = windowedHashrate(std::chrono::seconds(60));
+    s.hashrate15m = windowedHashrate(std::chrono::minutes(15));
     
     auto now = std::chrono::steady_clock::now();
     auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - m_startTime).count() / 1000.0;
+    s.uptime = running ? (uint64_t)elapsed : 0;
     
     if (elapsed > 0.1) {
         s.hashrate = m_totalHashes.load() / elapsed;
     } else {
         s.hashrate = 0;
     }
+
+    uint64_t batchSum = 0;
+    uint64_t busySum = 0, idleSum = 0;
+    for (const auto& worker : workers) {
+        s.arenaBytes += worker->arenaBytes.load();
+        s.hugePageBytes += worker->hugePageBytes.load();
+        batchSum += worker->batchSize.load(std::memory_order_relaxed);
+
+        WorkerStats ws;
+        ws.threadId = worker->id;
+        ws.cpu = worker->cpu.load(std::memory_order_relaxed);
+        ws.node = worker->node.load(std::memory_order_relaxed);
+        ws.hashes = worker->hashes.load(std::memory_order_relaxed);
+        ws.batchSize = worker->batchSize.load(std::memory_order_relaxed);
+        ws.busyNs = worker->busyNs.load(std::memory_order_relaxed);
+        ws.idleNs = worker->idleNs.load(std::memory_order_relaxed);
+        ws.cpuNs = worker->cpuNs.load(std::memory_order_relaxed);
+        if (s.cycleAccounting) {
+            ws.cycles.hash = worker->cycleHash.load(std::memory_order_relaxed);
+            ws.cycles.targetCheck = worker->cycleTargetCheck.load(std::memory_order_relaxed);
+            ws.cycles.jobCheck = worker->cycleJobCheck.load(std::memory_order_relaxed);
+            ws.cycles.share = worker->cycleShare.load(std::memory_order_relaxed);
+            ws.cycles.idle = worker->cycleIdle.load(std::memory_order_relaxed);
+            // Buckets and total are separate stores; a read between them
+            // must not make "other" wrap
+            uint64_t named = ws.cycles.total();
+            uint64_t total = worker->cycleTotal.load(std::memory_order_relaxed);
+            ws.cycles.other = total > named ? total - named : 0;
+            s.cycles.hash += ws.cycles.hash;
+            s.cycles.targetCheck += ws.cycles.targetCheck;
+            s.cycles.jobCheck += ws.cycles.jobCheck;
+            s.cycles.share += ws.cycles.share;
+            s.cycles.idle += ws.cycles.idle;
+            s.cycles.other += ws.cycles.other;
+        }
+        busySum += ws.busyNs;
+        idleSum += ws.idleNs;
+        s.workers.push_back(ws);
+    }
+    if (!workers.empty()) {
+        s.batchSize = (uint32_t)(batchSum / workers.size());
+    }
+    if (busySum + idleSum > 0) {
+        s.dutyCycle = (float)((double)busySum / (busySum + idleSum));
+    }
     
     return s;
 }
@@ -78,95 +366,618 @@ void Miner::setShareCallback(ShareCallback callback) {
     shareCallback = callback;
 }
 
+void Miner::setIntensity(float intensity) {
+    if (intensity < 0.01f) intensity = 0.01f;
+    if (intensity > 1.0f) intensity = 1.0f;
+    m_intensity.store(intensity);
+}
+
+float Miner::getIntensity() const {
+    return m_intensity.load();
+}
+
+// Duty cycle the workers actually run at
+float Miner::effectiveIntensity() const {
+    float intensity = m_intensity.load(std::memory_order_relaxed);
+    if (!m_config.throttleThreads) {
+        intensity *= m_thermalScale.load(std::memory_order_relaxed);
+    }
+    if (m_requestedThreads.load(std::memory_order_relaxed) <= 0) {
+        intensity *= m_quotaScale.load(std::memory_order_relaxed);
+    }
+    intensity *= m_foregroundScale.load(std::memory_order_relaxed);
+    return std::max(0.01f, intensity);
+}
+
+void Miner::monitorThread() {
+    instrument::AllocationScope allocScope(instrument::Subsystem::Monitor);
+    SystemMonitor monitor;
+    auto interval = std::chrono::milliseconds(m_config.monitorIntervalMs > 0 ? m_config.monitorIntervalMs : 1000);
+
+    // The cgroup quota can be changed under us (kubectl set resources, VPA)
+    const auto quotaCheckEvery = std::chrono::seconds(5);
+    auto lastQuotaCheck = std::chrono::steady_clock::now();
+
+    // Steal is noisy sample to sample; act on an EWMA
+    float smoothedSteal = 0.0f;
+    uint64_t prevCpuNs = 0, prevIdleNs = 0;
+    size_t prevWorkers = 0;
+    auto prevSample = std::chrono::steady_clock::now();
+
+    EnergyMeter energy;
+    double prevJoules = 0;
+    uint64_t prevHashes = 0;
+    bool efficiency = m_config.efficiencyMode;
+    if (efficiency && !energy.available()) {
+        logging::warn("Efficiency mode: no RAPL energy counter, tuning for hashrate instead");
+        efficiency = false;
+    }
+
+    // Autotuner: measure each setting over a window that starts after a
+    // settling delay (batch recalibration, caches, turbo ramp)
+    const auto settle = std::chrono::seconds(3);
+    const auto window = std::chrono::seconds(std::max(2, m_config.autotuneWindowSec));
+    std::vector<PlacementPolicy> placements;
+    if (m_config.autotunePlacement) {
+        PlacementPolicy initial = m_placement.load();
+        placements = { initial };
+        for (PlacementPolicy p : { PlacementPolicy::None, PlacementPolicy::Scatter,
+                                   PlacementPolicy::Compact, PlacementPolicy::PhysicalCores }) {
+            if (p != initial) placements.push_back(p);
+        }
+    }
+    AutoTuner tuner(m_config.autotuneMinThreads, m_usableCpus.load(), placements);
+    if (efficiency) {
+        // Fewer, busier threads vs more, lighter ones: the package draws
+        // idle power either way, so the best H/J is rarely at full load
+        tuner.setIntensityRange(m_config.efficiencyMinIntensity, getIntensity(), 0.1f);
+    }
+    TuneSetting applied;
+    auto changedAt = std::chrono::steady_clock::now();
+    auto markAt = changedAt;
+    uint64_t markHashes = 0;
+    double markJoules = 0;
+    bool marked = false;
+    if (m_config.autotune) {
+        std::lock_guard<std::mutex> workersLock(workersMutex);
+        applied.threads = std::max(std::max(1, m_config.autotuneMinThreads), targetThreadCount());
+        applied.placement = m_placement.load();
+        applied.intensity = getIntensity();
+        m_tunedThreads = applied.threads;
+        resizeWorkers(targetThreadCount());
+    }
+
+    std::unique_lock<std::mutex> lock(monitorMutex);
+    while (running) {
+        lock.unlock();
+        auto now = std::chrono::steady_clock::now();
+
+        {
+            std::lock_guard<std::mutex> samplesLock(samplesMutex);
+            m_hashSamples.emplace_back(now, m_totalHashes.load());
+            while (!m_hashSamples.empty() && now - m_hashSamples.front().first > std::chrono::minutes(16)) {
+                m_hashSamples.pop_front();
+            }
+        }
+
+        double joules = 0;
+        if (energy.available() && energy.sample(joules)) {
+            uint64_t hashes = m_totalHashes.load();
+            double seconds = std::chrono::duration<double>(now - prevSample).count();
+            double spent = joules - prevJoules;
+            if (seconds > 0) m_powerWatts = spent / seconds;
+            if (spent > 0) m_hashesPerJoule = (hashes - prevHashes) / spent;
+            m_energyJoules = joules;
+            prevJoules = joules;
+            prevHashes = hashes;
+        }
+
+        if (m_config.autotune && now - changedAt >= settle) {
+            if (!marked) {
+                markAt = now;
+                markHashes = m_totalHashes.load();
+                markJoules = joules;
+                marked = true;
+            } else if (now - markAt >= window) {
+                double seconds = std::chrono::duration<double>(now - markAt).count();
+                uint64_t hashes = m_totalHashes.load() - markHashes;
+                double score = hashes / seconds;
+                if (efficiency) {
+                    score = joules > markJoules ? hashes / (joules - markJoules) : 0.0;
+                }
+
+                tuner.setThreadLimits(m_config.autotuneMinThreads, m_usableCpus.load());
+                TuneSetting next = tuner.next(applied, score);
+                if (next != applied) {
+                    logging::info("Autotune: %d/%s/%g @ %g %s -> %d/%s/%g",
+                                  applied.threads, placementPolicyName(applied.placement), applied.intensity,
+                                  score, efficiency ? "H/J" : "H/s",
+                                  next.threads, placementPolicyName(next.placement), next.intensity);
+                    if (next.placement != applied.placement) setPlacement(next.placement);
+                    if (next.intensity != applied.intensity) setIntensity(next.intensity);
+                    m_tunedThreads = next.threads;
+                    {
+                        std::lock_guard<std::mutex> workersLock(workersMutex);
+                        if (running) resizeWorkers(targetThreadCount());
+                    }
+                    applied = next;
+                    changedAt = now;
+                    marked = false;
+                } else {
+                    // Same setting for the next window: no need to settle
+                    markAt = now;
+                    markHashes = m_totalHashes.load();
+                    markJoules = joules;
+                }
+            }
+        }
+        if (now - lastQuotaCheck >= quotaCheckEvery) {
+            lastQuotaCheck = now;
+            if (refreshUsableCpus() && m_requestedThreads.load() <= 0) {
+                std::lock_guard<std::mutex> workersLock(workersMutex);
+                if (running) resizeWorkers(targetThreadCount());
+            }
+        }
+        if (monitor.sample()) {
+            m_cpuUsage = monitor.cpuUsage();
+            m_cpuTemp = monitor.cpuTemp();
+            m_steal = monitor.stealPercent();
+            smoothedSteal = 0.7f * smoothedSteal + 0.3f * monitor.stealPercent();
+
+            float pressure = monitor.cpuPressure();
+            if (pressure < 0) {
+                // No PSI: runnable tasks beyond what our own workers account
+                // for, as a percentage of the usable CPUs
+                float ours = 0;
+                {
+                    std::lock_guard<std::mutex> workersLock(workersMutex);
+                    ours = workers.size() * effectiveIntensity();
+                }
+                pressure = 100.0f * std::max(0.0f, monitor.loadAverage() - ours) / m_usableCpus.load();
+            }
+            m_cpuPressure = pressure;
+        }
+
+        // Worker CPU time vs the wall time they wanted to run (interval
+        // minus duty-cycle idle). Skipped across resizes, which skew it.
+        {
+            uint64_t cpuNs = 0, idleNs = 0;
+            std::lock_guard<std::mutex> workersLock(workersMutex);
+            for (const auto& worker : workers) {
+                cpuNs += worker->cpuNs.load(std::memory_order_relaxed);
+                idleNs += worker->idleNs.load(std::memory_order_relaxed);
+            }
+            double wallNs = std::chrono::duration<double, std::nano>(now - prevSample).count() * workers.size();
+            double wantedNs = wallNs - (double)(idleNs - prevIdleNs);
+            if (workers.size() == prevWorkers && wantedNs > 0 && cpuNs >= prevCpuNs) {
+                m_workerEfficiency = (float)std::min(1.0, (cpuNs - prevCpuNs) / wantedNs);
+            }
+            prevCpuNs = cpuNs;
+            prevIdleNs = idleNs;
+            prevWorkers = workers.size();
+            prevSample = now;
+        }
+
+        if (m_config.stealScaling) {
+            updateStealScaling(smoothedSteal);
+        }
+        if (m_config.yieldToForeground) {
+            updateForegroundBackoff(m_cpuPressure.load());
+        }
+        if (m_config.tempLimit > 0 && m_cpuTemp.load() > 0) {
+            updateThermalGovernor(m_cpuTemp.load());
+        }
+        lock.lock();
+        monitorCv.wait_for(lock, interval, [this] { return !running; });
+    }
+}
+
+double Miner::windowedHashrate(std::chrono::seconds window) const {
+    std::lock_guard<std::mutex> lock(samplesMutex);
+    if (m_hashSamples.size() < 2) return 0.0;
+
+    const auto& newest = m_hashSamples.back();
+    auto oldest = m_hashSamples.front();
+    for (const auto& sample : m_hashSamples) {
+        if (newest.first - sample.first <= window) {
+            oldest = sample;
+            break;
+        }
+    }
+    double seconds = std::chrono::duration<double>(newest.first - oldest.first).count();
+    return seconds > 0 ? (newest.second - oldest.second) / seconds : 0.0;
+}
+
+// Re-read affinity and cgroup quota; returns true if the usable CPU count changed
+bool Miner::refreshUsableCpus() {
+    double quota = -1;
+    int usable = detectUsableCpus(&quota);
+    if (m_config.reservedCpu >= 0 && usable > 1) {
+        usable--;
+    }
+
+    // Running ceil(quota) workers at quota/ceil(quota) duty uses the whole
+    // quota without tripping CFS throttling (which stalls all workers for
+    // the rest of the period).
+    float scale = quota > 0 ? (float)(quota / usable) : 1.0f;
+    m_quotaScale = std::min(1.0f, scale);
+    m_cpuQuota = (float)quota;
+
+    int previous = m_usableCpus.exchange(usable);
+    if (previous == usable) return false;
+    if (quota > 0) logging::info("Usable CPUs: %d (cgroup quota %g)", usable, quota);
+    else logging::info("Usable CPUs: %d", usable);
+    return true;
+}
+
+// While the hypervisor steals time, extra runnable workers only add
+// context switches; shed one per interval and add them back once it calms.
+void Miner::updateStealScaling(float smoothedSteal) {
+    std::lock_guard<std::mutex> lock(workersMutex);
+    if (!running) return;
+
+    int shed = m_stealShed.load();
+    if (smoothedSteal > m_config.stealHigh && (int)workers.size() > 1) {
+        shed++;
+    } else if (smoothedSteal < m_config.stealLow && shed > 0) {
+        shed--;
+    } else {
+        return;
+    }
+
+    m_stealShed = shed;
+    logging::info("Steal %g%%, shedding %d worker(s)", smoothedSteal, shed);
+    resizeWorkers(targetThreadCount());
+}
+
+// Halve the duty cycle at once when something in the foreground is waiting
+// for a CPU (a UI thread stalled for even a second is noticeable), then
+// creep back up once it has been quiet
+static constexpr float kMinForegroundScale = 0.05f;
+
+void Miner::updateForegroundBackoff(float pressure) {
+    float scale = m_foregroundScale.load();
+    float next = scale;
+
+    if (pressure > m_config.pressureHigh) {
+        next = std::max(kMinForegroundScale, scale * 0.5f);
+    } else if (pressure < m_config.pressureLow) {
+        next = std::min(1.0f, scale + 0.1f);
+    }
+    if (next == scale) return;
+
+    m_foregroundScale = next;
+    logging::info("Foreground pressure %g%%, scale %g -> %g", pressure, scale, next);
+}
+
+// Back off 20% per interval while over the limit, recover 10% per interval
+// once below limit - hysteresis, hold in between. Acting a few degrees
+// below Tjmax keeps the CPU out of its own (much coarser) emergency
+// throttling, so sustained clocks stay higher.
+static constexpr float kMinThermalScale = 0.2f;
+
+void Miner::updateThermalGovernor(float temp) {
+    float scale = m_thermalScale.load();
+    float next = scale;
+
+    if (temp >= m_config.tempLimit) {
+        next = std::max(kMinThermalScale, scale * 0.8f);
+    } else if (temp <= m_config.tempLimit - m_config.tempHysteresis) {
+        next = std::min(1.0f, scale + 0.1f);
+    }
+    if (next == scale) return;
+
+    m_thermalScale = next;
+    logging::info("Thermal governor: %g C, scale %g -> %g", temp, scale, next);
+
+    if (m_config.throttleThreads) {
+        std::lock_guard<std::mutex> lock(workersMutex);
+        if (running) resizeWorkers(targetThreadCount());
+    }
+}
+
 void Miner::setJob(const stratum::Job& job) {
-    std::lock_guard<std::mutex> lock(jobMutex);
+    auto now = std::chrono::steady_clock::now();
+    if (job.receivedAt != std::chrono::steady_clock::time_point()) {
+        latency::record(latency::Stage::NotifyToSetJob, now - job.receivedAt);
+    }
+
+    std::unique_lock<InstrumentedMutex> lock(jobMutex);
+    if (m_jobDispatchNs > 0) {
+        double us = m_jobDispatchNs / 1000.0;
+        m_dispatchedJobs++;
+        m_dispatchSumUs += us;
+        m_dispatchMaxUs = std::max(m_dispatchMaxUs, us);
+    }
+    m_jobDispatchNs = 0;
     currentJob = job;
     hasJob = true;
-    // std::cout << "Miner received new job: " << job.jobId << std::endl;
+    m_jobSeq++;
+    m_jobPublishedAt = now;
+    trace::record(trace::Event::JobPublished, job.jobId.c_str(), m_jobSeq);
+    lock.unlock();
+    jobCv.notify_all();
+    logging::debug("Miner received new job: %s", job.jobId.c_str());
 }
 
-void Miner::workerThread(int threadId) {
-    std::cout << "Worker " << threadId << " started" << std::endl;
-    
-    uint64_t nonce = threadId * 1000000000ULL; // Big offset
-    uint64_t hashCount = 0;
-    auto startTime = std::chrono::steady_clock::now();
+// Header (32) + Timestamp (8) + Zeroes (32) + Nonce (8)
+static constexpr size_t kInputSize = 32 + 8 + 32 + 8;
+static constexpr size_t kNonceOffset = kInputSize - 8;
+// Input, digest and target take 224 bytes once cache-line aligned; one
+// page holds them. Arenas below a huge page never get one (see Arena).
+static constexpr size_t kWorkerArenaSize = 4096;
+
+// Batch length bounds; calibration starts small so the first batch is short
+static constexpr uint32_t kInitialBatch = 64;
+static constexpr uint32_t kMinBatch = 16;
+static constexpr uint32_t kMaxBatch = 1u << 20;
+
+// Move the batch length halfway toward the length that would have hit the
+// target. One preempted or interrupted batch can at most halve it.
+static uint32_t nextBatchSize(uint32_t current, double elapsedUs, double targetUs) {
+    double ideal = elapsedUs > 0 ? current * targetUs / elapsedUs : current * 2.0;
+    double next = (current + ideal) / 2;
+    if (next < kMinBatch) return kMinBatch;
+    if (next > kMaxBatch) return kMaxBatch;
+    return (uint32_t)next;
+}
+
+// Idle debt below this is carried to the next batch instead of slept off:
+// shorter sleeps are dominated by wakeup latency.
+static constexpr double kMinIdleSliceUs = 50.0;
+
+// Accumulators older than this are halved so a changed intensity takes
+// effect within about a second instead of being averaged away.
+static constexpr double kDutyWindowUs = 1000000.0;
+
+void Miner::workerThread(WorkerContext* ctx) {
+    const int threadId = ctx->id;
+    instrument::AllocationScope allocScope(instrument::Subsystem::Worker);
+    logging::info("Worker %d started", threadId);
+    trace::setThreadName("worker " + std::to_string(threadId));
+
+    // Pin before touching any memory: the arena and the local job copy are
+    // first-touched by this thread, so they are placed on its NUMA node.
+    int pinnedCpu = ctx->cpu.load();
+    if (pinnedCpu >= 0 && !pinCurrentThread(pinnedCpu)) {
+        logging::warn("Worker %d could not be pinned to CPU %d", threadId, pinnedCpu);
+    }
+    if (pinnedCpu < 0 && m_config.reservedCpu >= 0) {
+        pinCurrentThread(m_workerCpus);
+    }
+    if (m_config.scheduling != SchedulingClass::Normal && !setCurrentThreadScheduling(m_config.scheduling)) {
+        logging::warn("Worker %d could not switch to %s scheduling", threadId, schedulingClassName(m_config.scheduling));
+    }
+
+    // All per-hash state lives in this thread's arena, not the global heap
+    Arena arena(kWorkerArenaSize, m_config.hugePages);
+    uint8_t* input = arena.allocateArray<uint8_t>(kInputSize);
+    uint8_t* hash = arena.allocateArray<uint8_t>(HASH_SIZE);
+    uint8_t* target = arena.allocateArray<uint8_t>(HASH_SIZE);
+    if (!input || !hash || !target) {
+        logging::error("Worker %d failed to allocate arena", threadId);
+        return;
+    }
+    ctx->arenaBytes = arena.capacity();
+    // Measured once the constructor has faulted the arena in: THP is only
+    // a hint, so the kernel may have used 4 KB pages anyway
+    ctx->hugePageBytes = arena.hugePageBytes();
+
+#ifdef __linux__
+    // Idle slices are tens of microseconds; the default 50 us timer slack
+    // would make them overshoot by as much as they last.
+    prctl(PR_SET_TIMERSLACK, 1UL, 0, 0, 0);
+#endif
+
+    // Duty-cycle controller state: busy/idle time in the current window
+    double windowBusyUs = 0, windowIdleUs = 0;
+    float dutyIntensity = effectiveIntensity();
+
+    // On-CPU time of this thread; compared with wall time it shows how much
+    // the scheduler or hypervisor took away
+    uint64_t lastCpuNs = threadCpuTimeNs();
+
+    NonceLease lease = acquireLease();
+    uint64_t nonce = lease.next;
+    const double targetUs = m_config.batchTargetUs > 0 ? m_config.batchTargetUs : 200;
+    uint32_t batchSize = kInitialBatch;
+    uint32_t tuneEpoch = m_tuneEpoch.load();
     
     stratum::Job localJob;
+    uint64_t localSeq = 0;
     bool visibleJob = false;
+    std::chrono::steady_clock::time_point jobPublishedAt;
+    bool firstHashPending = false;
+
+    // Cycle accounting: local sums, published to ctx after each batch
+    const bool accounting = m_config.cycleAccounting;
+    const uint64_t cycleStart = accounting ? readCycleCounter() : 0;
+    CycleBreakdown cycles;
     
-    while (running) {
-        // Check for new job
-        if (hashCount % 1000 == 0 || !visibleJob) {
-            std::lock_guard<std::mutex> lock(jobMutex);
-            if (hasJob) {
-                if (localJob.jobId != currentJob.jobId || localJob.cleanJobs) {
-                    localJob = currentJob;
-                    visibleJob = true;
-                    // std::cout << "Thread " << threadId << " picked up job " << localJob.jobId << std::endl;
+    while (running && !ctx->retire) {
+        // Start calibration over when the thread count or kernel changed
+        if (tuneEpoch != m_tuneEpoch.load(std::memory_order_relaxed)) {
+            tuneEpoch = m_tuneEpoch.load();
+            batchSize = kInitialBatch;
+        }
+
+        // Placement changed at runtime: move to the new CPU (or unpin)
+        int wantCpu = ctx->cpu.load(std::memory_order_relaxed);
+        if (wantCpu != pinnedCpu) {
+            if (wantCpu >= 0) pinCurrentThread(wantCpu);
+            else pinCurrentThread(m_workerCpus);
+            pinnedCpu = wantCpu;
+        }
+
+        // Check for new job (once per batch, i.e. every ~batchTargetUs)
+        bool switched = false;
+        bool waited = false;
+        uint64_t mark = accounting ? readCycleCounter() : 0;
+        {
+            std::unique_lock<InstrumentedMutex> lock(jobMutex);
+            if (!hasJob) {
+                // Nothing to hash yet: wake on setJob(), stop() or retirement
+                // instead of polling. The flags are set before the notifier
+                // takes jobMutex, so the predicate cannot miss them.
+                jobCv.wait_for(lock, std::chrono::milliseconds(100),
+                               [this, ctx]() { return hasJob || !running || ctx->retire; });
+                waited = true;
+            }
+            if (hasJob && localSeq != m_jobSeq) {
+                localJob = currentJob;
+                localSeq = m_jobSeq;
+                jobPublishedAt = m_jobPublishedAt;
+                visibleJob = true;
+                switched = true;
+                firstHashPending = true;
+                if (localJob.receivedAt != std::chrono::steady_clock::time_point()) {
+                    int64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        std::chrono::steady_clock::now() - localJob.receivedAt).count();
+                    m_jobDispatchNs = std::max(m_jobDispatchNs, ns);
                 }
             }
         }
+        if (accounting) {
+            uint64_t now = readCycleCounter();
+            (waited ? cycles.idle : cycles.jobCheck) += now - mark;
+        }
         
+        if (switched) {
+            trace::record(trace::Event::JobPickedUp, localJob.jobId.c_str(), localSeq);
+            logging::debug("Worker %d picked up job %s", threadId, localJob.jobId.c_str());
+        }
         if (!visibleJob) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
             continue;
         }
 
         // --- Block Construction (Kaspa) ---
-        // Header (32) + Timestamp (8) + Zeroes (32) + Nonce (8)
-        std::vector<uint8_t> input;
-        input.reserve(32 + 8 + 32 + 8);
-        
+        std::memset(input, 0, kInputSize);
+
         // 1. PrePowHash
-        if(localJob.header.size() < 32) {
-             localJob.header.resize(32, 0); 
-        }
-        input.insert(input.end(), localJob.header.begin(), localJob.header.end());
+        std::memcpy(input, localJob.header.data(), std::min<size_t>(localJob.header.size(), 32));
         
         // 2. Timestamp (Little Endian)
         uint64_t ts = localJob.timestamp;
-        for(int i=0; i<8; i++) input.push_back((ts >> (i*8)) & 0xFF);
+        for(int i=0; i<8; i++) input[32 + i] = (ts >> (i*8)) & 0xFF;
         
-        // 3. Zeroes
-        for(int i=0; i<32; i++) input.push_back(0);
-        
-        // 4. Nonce placeholder (will be set in loop)
-        for(int i=0; i<8; i++) input.push_back(0);
+        // 3. Zeroes (already cleared), 4. Nonce (set in loop)
+
+        // A malformed target never matches (same as the vector overload)
+        if (localJob.target.size() == HASH_SIZE) {
+            std::memcpy(target, localJob.target.data(), HASH_SIZE);
+        } else {
+            std::memset(target, 0, HASH_SIZE);
+        }
         
+        // Never run past the end of the lease. A returned remainder can be
+        // shorter than a batch; hash what is left of it rather than drop it.
+        if (nonce >= lease.end) {
+            lease = acquireLease();
+            nonce = lease.next;
+        }
+        const uint32_t count = (uint32_t)std::min<uint64_t>(batchSize, lease.end - nonce);
+
         // --- Loop ---
-        for (int i = 0; i < 2000; i++) {
+        const auto batchStart = std::chrono::steady_clock::now();
+        if (firstHashPending) {
+            latency::record(latency::Stage::SetJobToFirstHash, batchStart - jobPublishedAt);
+            firstHashPending = false;
+        }
+        if (accounting) mark = readCycleCounter();
+        for (uint32_t i = 0; i < count; i++) {
             // Set Nonce at end of input
             for(int j=0; j<8; j++) {
-                input[input.size() - 8 + j] = (nonce >> (j*8)) & 0xFF;
+                input[kNonceOffset + j] = (nonce >> (j*8)) & 0xFF;
             }
             
             // Hash
-            auto hash = calculateHash(input, 0); 
-            hashCount++;
+            calculateHash(input, kInputSize, hash);
+            if (accounting) {
+                uint64_t now = readCycleCounter();
+                cycles.hash += now - mark;
+                mark = now;
+            }
             
             // Check Difficulty
-            if (checkDifficulty(hash, localJob.target)) {
-                std::cout << "Worker " << threadId << " found share! Nonce: " << nonce << std::endl;
+            bool found = checkDifficulty(hash, target, HASH_SIZE);
+            if (accounting) {
+                uint64_t now = readCycleCounter();
+                cycles.targetCheck += now - mark;
+                mark = now;
+            }
+            if (found) {
+                const auto foundAt = std::chrono::steady_clock::now();
+                trace::record(trace::Event::CandidateFound, localJob.jobId.c_str(), nonce);
+                logging::info("Worker %d found share! Nonce: %llu", threadId, (unsigned long long)nonce);
                 m_sharesAccepted++;
                 
                 if (shareCallback) {
                     shareCallback(true, "Share found", localJob.jobId, 0, nonce, (uint32_t)ts);
+                    // Client::submit() only queues the request, so this ends at enqueue
+                    latency::record(latency::Stage::CandidateToEnqueue, std::chrono::steady_clock::now() - foundAt);
+                }
+                if (accounting) {
+                    uint64_t now = readCycleCounter();
+                    cycles.share += now - mark;
+                    mark = now;
                 }
             }
             nonce++;
         }
         
-        m_totalHashes += 2000;
+        m_totalHashes += count;
+        ctx->hashes.fetch_add(count, std::memory_order_relaxed);
 
-        // Log hashrate for CLI verification (Thread 0 only to avoid spam)
-        if (threadId == 0 && hashCount % 100000 == 0) {
-             double currentHr = m_totalHashes.load() / std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - startTime).count();
-             // std::cout << "[Miner] Cumulative Hashrate: " << currentHr << " H/s" << std::endl;
+        double elapsedUs = std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - batchStart).count();
+        // A clamped batch says nothing about the right batch length
+        if (count == batchSize) batchSize = nextBatchSize(batchSize, elapsedUs, targetUs);
+        ctx->batchSize.store(batchSize, std::memory_order_relaxed);
+        ctx->busyNs.fetch_add((uint64_t)(elapsedUs * 1000), std::memory_order_relaxed);
+        uint64_t cpuNow = threadCpuTimeNs();
+        ctx->cpuNs.fetch_add(cpuNow - lastCpuNs, std::memory_order_relaxed);
+        lastCpuNs = cpuNow;
+        if (accounting) {
+            ctx->cycleHash.store(cycles.hash, std::memory_order_relaxed);
+            ctx->cycleTargetCheck.store(cycles.targetCheck, std::memory_order_relaxed);
+            ctx->cycleJobCheck.store(cycles.jobCheck, std::memory_order_relaxed);
+            ctx->cycleShare.store(cycles.share, std::memory_order_relaxed);
+            ctx->cycleIdle.store(cycles.idle, std::memory_order_relaxed);
+            ctx->cycleTotal.store(readCycleCounter() - cycleStart, std::memory_order_relaxed);
+        }
+
+        // --- Duty cycle ---
+        // Sleep off the idle time owed for the measured busy time. The slept
+        // time is measured too, so oversleep is repaid by a shorter slice next
+        // batch and the long-run ratio converges on the target.
+        float intensity = effectiveIntensity();
+        if (intensity != dutyIntensity) {
+            dutyIntensity = intensity;
+            windowBusyUs = windowIdleUs = 0;
+        }
+        if (intensity >= 1.0f) continue;
+
+        windowBusyUs += elapsedUs;
+        double owedUs = windowBusyUs * (1.0 - intensity) / intensity - windowIdleUs;
+        if (owedUs >= kMinIdleSliceUs && running) {
+            auto idleStart = std::chrono::steady_clock::now();
+            if (accounting) mark = readCycleCounter();
+            std::this_thread::sleep_for(std::chrono::duration<double, std::micro>(owedUs));
+            if (accounting) cycles.idle += readCycleCounter() - mark;
+            double sleptUs = std::chrono::duration<double, std::micro>(
+                std::chrono::steady_clock::now() - idleStart).count();
+            windowIdleUs += sleptUs;
+            ctx->idleNs.fetch_add((uint64_t)(sleptUs * 1000), std::memory_order_relaxed);
+        }
+        if (windowBusyUs + windowIdleUs > kDutyWindowUs) {
+            windowBusyUs /= 2;
+            windowIdleUs /= 2;
         }
     }
     
-    std::cout << "Worker " << threadId << " stopped" << std::endl;
+    lease.next = nonce;
+    releaseLease(lease);
+    logging::info("Worker %d stopped", threadId);
 }
 
 void Miner::updateHashrate() {
@@ -0,0 +1,128 @@
+#include "monitor.h"
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <ctime>
+
+#ifdef _WIN32
+    #include <windows.h>
+#endif
+
+namespace kuzadesign {
+
+// Thermal zone / hwmon names that describe the CPU package rather than
+// e.g. the chipset, battery or wifi card
+static bool isCpuSensor(const std::string& name) {
+    static const char* kNames[] = {
+        "x86_pkg_temp", "coretemp", "k10temp", "zenpower", "cpu_thermal", "cpu-thermal", "soc_thermal"
+    };
+    for (const char* n : kNames) {
+        if (name.find(n) != std::string::npos) return true;
+    }
+    return false;
+}
+
+static bool readLine(const std::string& path, std::string& out) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::getline(file, out);
+    return true;
+}
+
+SystemMonitor::SystemMonitor(const std::string& procRoot, const std::string& sysRoot)
+    : m_procRoot(procRoot), m_sysRoot(sysRoot) {
+}
+
+bool SystemMonitor::sample() {
+    std::string line;
+    if (!readLine(m_procRoot + "/stat", line) || line.compare(0, 4, "cpu ") != 0) {
+        return false;
+    }
+
+    // cpu  user nice system idle iowait irq softirq steal guest guest_nice
+    std::istringstream fields(line.substr(4));
+    uint64_t values[8] = {0};
+    for (int i = 0; i < 8 && (fields >> values[i]); i++) {
+    }
+
+    // guest time is already counted in user, so it is not added again
+    uint64_t total = 0;
+    for (uint64_t v : values) total += v;
+    uint64_t idle = values[3] + values[4];
+    uint64_t steal = values[7];
+
+    if (m_primed && total > m_prevTotal) {
+        uint64_t dTotal = total - m_prevTotal;
+        uint64_t dIdle = idle - m_prevIdle;
+        m_cpuUsage = 100.0f * (float)(dTotal - dIdle) / (float)dTotal;
+        m_steal = 100.0f * (float)(steal - m_prevSteal) / (float)dTotal;
+    }
+    m_prevTotal = total;
+    m_prevIdle = idle;
+    m_prevSteal = steal;
+    m_primed = true;
+
+    m_cpuTemp = readTemperature();
+    m_cpuPressure = readPressure();
+    if (readLine(m_procRoot + "/loadavg", line)) {
+        m_loadAverage = (float)std::atof(line.c_str());
+    }
+    return true;
+}
+
+float SystemMonitor::readPressure() const {
+    // some avg10=1.23 avg60=0.50 avg300=0.10 total=123456
+    std::string line;
+    if (!readLine(m_procRoot + "/pressure/cpu", line) || line.compare(0, 5, "some ") != 0) {
+        return -1.0f;
+    }
+    size_t pos = line.find("avg10=");
+    if (pos == std::string::npos) return -1.0f;
+    return (float)std::atof(line.c_str() + pos + 6);
+}
+
+float SystemMonitor::readTemperature() const {
+    // Prefer a thermal zone that is clearly the CPU package
+    float fallback = 0.0f;
+    for (int i = 0; i < 32; i++) {
+        std::string base = m_sysRoot + "/class/thermal/thermal_zone" + std::to_string(i);
+        std::string type, temp;
+        if (!readLine(base + "/type", type)) break;
+        if (!readLine(base + "/temp", temp) || temp.empty()) continue;
+
+        float celsius = std::atoi(temp.c_str()) / 1000.0f;
+        if (isCpuSensor(type)) return celsius;
+        if (i == 0) fallback = celsius;
+    }
+
+    // hwmon drivers (coretemp/k10temp) when no thermal zone is labelled
+    for (int i = 0; i < 32; i++) {
+        std::string base = m_sysRoot + "/class/hwmon/hwmon" + std::to_string(i);
+        std::string name, temp;
+        if (!readLine(base + "/name", name)) continue;
+        if (!isCpuSensor(name)) continue;
+        if (readLine(base + "/temp1_input", temp) && !temp.empty()) {
+            return std::atoi(temp.c_str()) / 1000.0f;
+        }
+    }
+
+    return fallback;
+}
+
+uint64_t threadCpuTimeNs() {
+#ifdef _WIN32
+    FILETIME creation, exit, kernel, user;
+    if (!GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user)) return 0;
+    uint64_t k = ((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime;
+    uint64_t u = ((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime;
+    return (k + u) * 100; // 100 ns units
+#elif defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0;
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#else
+    return 0;
+#endif
+}
+
+} // namespace kuzadesign
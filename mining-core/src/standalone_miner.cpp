@@ -1,28 +1,176 @@
 #include "miner.h"
 #include "stratum.h"
+#include "hash.h"
+#include "trace.h"
+#include "metrics.h"
+#include "log.h"
 #include <iostream>
+#include <atomic>
+#include <iomanip>
+#include <fstream>
 #include <thread>
 #include <chrono>
 #include <string>
 #include <vector>
+#include <cmath>
+#include <ctime>
 #include <signal.h>
 
 using namespace kuzadesign;
 
-bool g_running = true;
+std::atomic<bool> g_running{true};     // Read by the housekeeping thread
+volatile sig_atomic_t g_dumpTrace = 0;
 
 void signalHandler(int signum) {
     std::cout << "\nInterrupt signal (" << signum << ") received. Stopping...\n";
     g_running = false;
 }
 
+// Only sets a flag; the housekeeping thread writes the trace file
+void traceSignalHandler(int) {
+    g_dumpTrace = 1;
+}
+
+struct BenchmarkRun {
+    int threads = 0;
+    double hashrate = 0;
+    double efficiency = 0;              // hashrate / (threads * 1-thread hashrate)
+    double threadMean = 0;
+    double threadStddev = 0;
+    std::vector<double> perThread;
+};
+
+// Offline hardware qualification: hash a synthetic job (unreachable target,
+// so no shares) at 1..maxThreads workers with the configured placement
+// and intensity, and report throughput, scaling and per-thread spread.
+static int runBenchmark(MiningConfig config, int seconds, int maxThreads, const std::string& jsonPath) {
+    CpuTopology topology = CpuTopology::discover();
+    if (maxThreads <= 0) maxThreads = detectUsableCpus();
+    seconds = std::max(1, seconds);
+    const auto warmup = std::chrono::seconds(1);
+
+    stratum::Job job;
+    job.jobId = "benchmark";
+    job.header.resize(32);
+    for (size_t i = 0; i < job.header.size(); i++) job.header[i] = (uint8_t)(i * 37 + 11);
+    job.timestamp = 1700000000000ULL;
+    job.cleanJobs = true;
+    job.target.assign(HASH_SIZE, 0);
+    job.extraNonce2Size = 4;
+
+    std::vector<BenchmarkRun> runs;
+    for (int n = 1; n <= maxThreads && g_running; n++) {
+        config.numThreads = n;
+        config.autotune = false;
+        config.efficiencyMode = false;
+
+        Miner miner;
+        miner.start(config);
+        miner.setJob(job);
+        std::this_thread::sleep_for(warmup);
+
+        MiningStats before = miner.getStats();
+        auto t0 = std::chrono::steady_clock::now();
+        std::this_thread::sleep_for(std::chrono::seconds(seconds));
+        MiningStats after = miner.getStats();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        miner.stop();
+
+        BenchmarkRun run;
+        run.threads = n;
+        for (size_t i = 0; i < after.workers.size() && i < before.workers.size(); i++) {
+            run.perThread.push_back((after.workers[i].hashes - before.workers[i].hashes) / elapsed);
+        }
+        for (double rate : run.perThread) run.hashrate += rate;
+        if (!run.perThread.empty()) {
+            run.threadMean = run.hashrate / run.perThread.size();
+            double var = 0;
+            for (double rate : run.perThread) var += (rate - run.threadMean) * (rate - run.threadMean);
+            run.threadStddev = std::sqrt(var / run.perThread.size());
+        }
+        double single = runs.empty() ? run.hashrate : runs.front().hashrate;
+        run.efficiency = single > 0 ? run.hashrate / (n * single) : 0;
+        runs.push_back(run);
+    }
+
+    std::cout << "\nKernel: " << hashKernelName() << ", CPUs: " << topology.cpus().size()
+              << " (" << topology.coreCount() << " cores, " << topology.nodeCount() << " nodes)"
+              << ", placement: " << placementPolicyName(config.placement)
+              << ", intensity: " << config.intensity << ", " << seconds << " s per step\n";
+    std::cout << std::setw(8) << "threads" << std::setw(14) << "H/s" << std::setw(12) << "scaling"
+              << std::setw(14) << "H/s/thread" << std::setw(10) << "cv %" << "\n";
+    for (const auto& run : runs) {
+        double cv = run.threadMean > 0 ? 100.0 * run.threadStddev / run.threadMean : 0;
+        std::cout << std::fixed << std::setprecision(0) << std::setw(8) << run.threads
+                  << std::setw(14) << run.hashrate << std::setprecision(3) << std::setw(12) << run.efficiency
+                  << std::setprecision(0) << std::setw(14) << run.threadMean
+                  << std::setprecision(1) << std::setw(10) << cv << "\n";
+    }
+    std::cout.unsetf(std::ios::floatfield);
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "kernel", hashKernelName());
+    cJSON_AddNumberToObject(root, "cpus", (double)topology.cpus().size());
+    cJSON_AddNumberToObject(root, "cores", topology.coreCount());
+    cJSON_AddNumberToObject(root, "nodes", topology.nodeCount());
+    cJSON_AddStringToObject(root, "placement", placementPolicyName(config.placement));
+    cJSON_AddNumberToObject(root, "intensity", config.intensity);
+    cJSON_AddNumberToObject(root, "secondsPerStep", seconds);
+    cJSON* results = cJSON_AddArrayToObject(root, "results");
+    for (const auto& run : runs) {
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddNumberToObject(item, "threads", run.threads);
+        cJSON_AddNumberToObject(item, "hashrate", run.hashrate);
+        cJSON_AddNumberToObject(item, "scalingEfficiency", run.efficiency);
+        cJSON_AddNumberToObject(item, "threadMean", run.threadMean);
+        cJSON_AddNumberToObject(item, "threadStddev", run.threadStddev);
+        cJSON* perThread = cJSON_AddArrayToObject(item, "perThread");
+        for (double rate : run.perThread) cJSON_AddItemToArray(perThread, cJSON_CreateNumber(rate));
+        cJSON_AddItemToArray(results, item);
+    }
+    char* text = cJSON_Print(root);
+    if (!jsonPath.empty()) {
+        std::ofstream(jsonPath) << text << "\n";
+        std::cout << "JSON written to " << jsonPath << "\n";
+    } else {
+        std::cout << text << "\n";
+    }
+    cJSON_free(text);
+    cJSON_Delete(root);
+    return runs.empty() ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
     signal(SIGINT, signalHandler);
+#ifdef SIGUSR1
+    signal(SIGUSR1, traceSignalHandler);
+#endif
 
     std::string host = "144.91.66.97";
     int port = 5555;
     std::string user = "kuzadesign:qqpqx7vz0y444gx6k2w42vz83h5p785ygu97z30y5y";
-    int threads = 2;
+    int threads = 0; // auto
+    int batchUs = 200;
+    float intensity = 1.0f;
+    PlacementPolicy placement = PlacementPolicy::None;
+    int numaNode = -1;
+    float tempLimit = 0.0f;
+    bool stealScaling = false;
+    bool autotune = false;
+    int autotuneMin = 1;
+    bool efficiency = false;
+    SchedulingClass scheduling = SchedulingClass::Normal;
+    bool yieldToForeground = false;
+    int reserveCpu = -1;
+    bool netPriority = false;
+    bool cycleAccounting = false;
+    int metricsPort = 0;
+    std::string metricsBind = "127.0.0.1";
+    bool benchmark = false;
+    int benchSeconds = 10;
+    int benchMaxThreads = 0;
+    std::string benchJson;
+    std::string traceDir = ".";
 
     for (int i = 1; i < argc; i++) {
         std::string arg = argv[i];
@@ -30,12 +178,77 @@ int main(int argc, char** argv) {
         else if (arg == "--port" && i + 1 < argc) port = std::stoi(argv[++i]);
         else if (arg == "--user" && i + 1 < argc) user = argv[++i];
         else if (arg == "--threads" && i + 1 < argc) threads = std::stoi(argv[++i]);
+        else if (arg == "--batch-us" && i + 1 < argc) batchUs = std::stoi(argv[++i]);
+        else if (arg == "--intensity" && i + 1 < argc) intensity = std::stof(argv[++i]);
+        else if (arg == "--placement" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parsePlacementPolicy(name, placement)) {
+                std::cerr << "Unknown placement '" << name << "' (none|compact|scatter|physical|node)\n";
+                return 1;
+            }
+        }
+        else if (arg == "--numa-node" && i + 1 < argc) numaNode = std::stoi(argv[++i]);
+        else if (arg == "--temp-limit" && i + 1 < argc) tempLimit = std::stof(argv[++i]);
+        else if (arg == "--steal-scaling") stealScaling = true;
+        else if (arg == "--autotune") autotune = true;
+        else if (arg == "--autotune-min" && i + 1 < argc) autotuneMin = std::stoi(argv[++i]);
+        else if (arg == "--efficiency") efficiency = true;
+        else if (arg == "--sched" && i + 1 < argc) {
+            std::string name = argv[++i];
+            if (!parseSchedulingClass(name, scheduling)) {
+                std::cerr << "Unknown scheduling class '" << name << "' (normal|background|idle)\n";
+                return 1;
+            }
+        }
+        else if (arg == "--yield") yieldToForeground = true;
+        else if (arg == "--reserve-cpu" && i + 1 < argc) reserveCpu = std::stoi(argv[++i]);
+        else if (arg == "--net-priority") netPriority = true;
+        else if (arg == "--cycle-accounting") cycleAccounting = true;
+        else if (arg == "--metrics-port" && i + 1 < argc) metricsPort = std::stoi(argv[++i]);
+        else if (arg == "--metrics-bind" && i + 1 < argc) metricsBind = argv[++i];
+        else if (arg == "--log-level" && i + 1 < argc) {
+            std::string name = argv[++i];
+            logging::Level level;
+            if (!logging::parseLevel(name, level)) {
+                std::cerr << "Unknown log level '" << name << "' (debug|info|warn|error|off)\n";
+                return 1;
+            }
+            logging::setLevel(level);
+        }
+        else if (arg == "--benchmark") benchmark = true;
+        else if (arg == "--bench-seconds" && i + 1 < argc) benchSeconds = std::stoi(argv[++i]);
+        else if (arg == "--bench-max-threads" && i + 1 < argc) benchMaxThreads = std::stoi(argv[++i]);
+        else if (arg == "--bench-json" && i + 1 < argc) benchJson = argv[++i];
+        else if (arg == "--trace-dir" && i + 1 < argc) traceDir = argv[++i];
+        else if (arg == "--no-trace") trace::setEnabled(false);
+    }
+
+    MiningConfig config;
+    config.numThreads = threads;
+    config.batchTargetUs = batchUs;
+    config.intensity = intensity;
+    config.placement = placement;
+    config.numaNode = numaNode;
+    config.tempLimit = tempLimit;
+    config.stealScaling = stealScaling;
+    config.autotune = autotune;
+    config.autotuneMinThreads = autotuneMin;
+    config.efficiencyMode = efficiency;
+    config.scheduling = scheduling;
+    config.yieldToForeground = yieldToForeground;
+    config.reservedCpu = reserveCpu;
+    config.cycleAccounting = cycleAccounting;
+
+    if (benchmark) {
+        return runBenchmark(config, benchSeconds, benchMaxThreads, benchJson);
     }
 
     std::cout << "Kuzadesign Standalone Miner v1.0 (Windows Fallback)\n";
     std::cout << "Target: " << host << ":" << port << "\n";
     std::cout << "Wallet: " << user << "\n";
-    std::cout << "Threads: " << threads << "\n";
+    std::cout << "Threads: " << (threads > 0 ? std::to_string(threads) : "auto") << "\n";
+    std::cout << "Intensity: " << intensity << "\n";
+    std::cout << "Placement: " << placementPolicyName(placement) << "\n";
 
     Miner miner;
     stratum::Client client;
@@ -50,9 +263,32 @@ int main(int argc, char** argv) {
         client.submit(jobId, ntime, nonce, extraNonce2);
     });
 
-    MiningConfig config;
-    config.numThreads = threads;
     miner.start(config);
+    trace::setThreadName("network");
+
+    // OpenMetrics on http://<bind>:<port>/metrics, served from its own thread
+    MetricsServer metrics;
+    if (metricsPort > 0) {
+        auto provider = [&miner, &client]() {
+            MetricsInfo info;
+            info.connected = client.isConnected();
+            info.shares = client.shareCounts();
+            return renderOpenMetrics(miner.getStats(), info);
+        };
+        if (metrics.start(metricsBind, metricsPort, provider)) {
+            std::cout << "Metrics: http://" << metricsBind << ":" << metrics.port() << "/metrics\n";
+        }
+    }
+
+    // This thread is the network thread: give it the reserved CPU and/or a
+    // priority above the hashing threads so notifies are not queued behind them
+    if (reserveCpu >= 0 && !pinCurrentThread(reserveCpu)) {
+        std::cerr << "Could not pin network thread to CPU " << reserveCpu << "\n";
+    }
+    if (netPriority && !setCurrentThreadScheduling(SchedulingClass::Elevated)) {
+        std::cerr << "Could not raise network thread priority (needs CAP_SYS_NICE); "
+                  << "consider --sched background for the workers instead\n";
+    }
 
     if (!client.connect(host, port)) {
         std::cerr << "CRITICAL: Failed to connect to pool\n";
@@ -62,29 +298,94 @@ int main(int argc, char** argv) {
     client.subscribe("kzd-standalone/1.0");
     client.login(user, "x");
 
+    // Everything periodic runs beside the network thread, which only wakes
+    // for pool traffic: stats every 5 s, trace dumps, and the shutdown signal
+    std::thread housekeeping([&miner, &client, &traceDir]() {
+        trace::setThreadName("housekeeping");
+        int tick = 0;
+        while (g_running) {
+            // kill -USR1 <pid>: dump the event trace rings (chrome://tracing)
+            if (g_dumpTrace) {
+                g_dumpTrace = 0;
+                std::string path = traceDir + "/kzd-trace-" + std::to_string(std::time(nullptr)) + ".json";
+                if (trace::writeChromeTrace(path)) logging::info("Trace written to %s", path.c_str());
+                else logging::error("Could not write trace to %s", path.c_str());
+            }
+
+            // Through the logger, whose thread also writes stdout, so the
+            // lines below never interleave with other output mid-line
+            if (tick++ % 50 == 0) {
+                auto stats = miner.getStats();
+                // Format strictly for Electron to parse: [STATS]|hashrate|shares
+                logging::status("[STATS]|%g|%llu", stats.hashrate, (unsigned long long)stats.sharesAccepted);
+                if (stats.notifyLatencyAvgUs > 0) {
+                    logging::info("Notify latency: %g us avg, %g us max", stats.notifyLatencyAvgUs, stats.notifyLatencyMaxUs);
+                }
+                const std::pair<const char*, const LatencySummary*> stages[] = {
+                    { "read->handled", &stats.readToHandled },
+                    { "notify->setJob", &stats.notifyToSetJob },
+                    { "setJob->first hash", &stats.setJobToFirstHash },
+                    { "candidate->enqueue", &stats.candidateToEnqueue },
+                    { "submit->ack", &stats.submitToAck },
+                };
+                for (const auto& stage : stages) {
+                    if (stage.second->count == 0) continue;
+                    logging::info("  %s: p50 %g us, p99 %g us, p999 %g us (%llu)", stage.first, stage.second->p50Us,
+                                  stage.second->p99Us, stage.second->p999Us, (unsigned long long)stage.second->count);
+                }
+                for (const instrument::LockStats* lock : { &stats.jobLock, &stats.sendLock }) {
+                    if (lock->contended == 0) continue;
+                    logging::info("  %s lock: %llu of %llu acquisitions waited, p99 %g us, max %g us",
+                                  lock == &stats.jobLock ? "job" : "send", (unsigned long long)lock->contended,
+                                  (unsigned long long)lock->acquisitions, lock->wait.p99Us, lock->wait.maxUs);
+                }
+                if (stats.allocationTracking) {
+                    std::string line = "  allocations:";
+                    for (size_t i = 0; i < (size_t)instrument::Subsystem::Count; i++) {
+                        line += std::string(" ") + instrument::subsystemName((instrument::Subsystem)i) + " " +
+                                std::to_string(stats.allocations[i].allocations);
+                    }
+                    logging::info("%s", line.c_str());
+                }
+                if (stats.cycleAccounting) {
+                    for (const auto& w : stats.workers) {
+                        const CycleBreakdown& c = w.cycles;
+                        if (c.total() == 0) continue;
+                        logging::info("  worker %d cycles: hash %.1f%%, target %.1f%%, job %.1f%%, share %.1f%%, "
+                                      "idle %.1f%%, other %.1f%%", w.threadId, 100 * c.fraction(c.hash),
+                                      100 * c.fraction(c.targetCheck), 100 * c.fraction(c.jobCheck),
+                                      100 * c.fraction(c.share), 100 * c.fraction(c.idle), 100 * c.fraction(c.other));
+                    }
+                }
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        client.stop();
+    });
+
     while (g_running) {
         if (!client.isConnected()) {
-            std::cout << "\n[Pool] Connection lost. Reconnecting in 3s...\n";
-            std::this_thread::sleep_for(std::chrono::seconds(3));
+            logging::warn("[Pool] Connection lost. Reconnecting in 3s...");
+            for (int i = 0; i < 30 && g_running; i++) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            if (!g_running) break;
             if (client.connect(host, port)) {
                 client.subscribe("kzd-standalone/1.0");
                 client.login(user, "x");
-                std::cout << "[Pool] Reconnected successfully\n";
+                logging::info("[Pool] Reconnected successfully");
             }
+            continue;
         }
 
-        client.process();
-        std::this_thread::sleep_for(std::chrono::milliseconds(100));
-        
-        static int counter = 0;
-        if (counter++ % 50 == 0) {
-            auto stats = miner.getStats();
-            // Format strictly for Electron to parse: [STATS]|hashrate|shares
-            std::cout << "[STATS]|" << stats.hashrate << "|" << stats.sharesAccepted << std::endl;
-        }
+        // Returns on shutdown or when the pool drops the connection
+        client.run();
     }
+    housekeeping.join();
 
+    metrics.stop();
     miner.stop();
     client.disconnect();
+    logging::flush();
     return 0;
 }
@@ -1,10 +1,16 @@
 #include "../../include/stratum.h"
-#include <iostream>
+#include "../../include/trace.h"
+#include "../../include/latency.h"
+#include "../../include/log.h"
+#include "../../include/protocol.h"
+#include <algorithm>
 #include <cstring>
 #include <sstream>
 #include <cstdlib>
 #include <thread>
 #include <chrono>
+#include <ctime>
+#include <cctype>
 
 #ifndef _WIN32
     #include <sys/socket.h>
@@ -12,6 +18,9 @@
     #include <netdb.h>
     #include <unistd.h>
     #include <fcntl.h>
+    #include <sys/select.h>
+    #include <sys/uio.h>
+    #include <netinet/tcp.h>
 #else
     #include <winsock2.h>
     #include <ws2tcpip.h>
@@ -19,18 +28,31 @@
     #include <chrono>
 #endif
 
+#ifdef __linux__
+    #include <sys/epoll.h>
+    #include <sys/eventfd.h>
+#endif
+
 namespace kuzadesign {
 namespace stratum {
 
-Client::Client() : socket_fd(INVALID_SOCKET_VAL), connected(false) {
+static constexpr size_t kMaxPendingSubmits = 256;
+
+Client::Client() : socket_fd(INVALID_SOCKET_VAL), connected(false), outbound(new OutboundSlot[kOutboundSlots]) {
 #ifdef _WIN32
     WSADATA wsaData;
     WSAStartup(MAKEWORD(2, 2), &wsaData);
 #endif
+#ifdef __linux__
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+#endif
 }
 
 Client::~Client() {
     disconnect();
+#ifdef __linux__
+    if (wakeFd >= 0) close(wakeFd);
+#endif
 #ifdef _WIN32
     WSACleanup();
 #endif
@@ -42,13 +64,13 @@ bool Client::connect(const std::string& host, int port) {
     
     struct hostent *server = gethostbyname(host.c_str());
     if (server == NULL) {
-        std::cerr << "Error: No such host " << host << std::endl;
+        logging::error("Error: No such host %s", host.c_str());
         return false;
     }
 
     socket_fd = socket(AF_INET, SOCK_STREAM, 0);
     if (socket_fd < 0) {
-        std::cerr << "Error opening socket" << std::endl;
+        logging::error("Error opening socket");
         return false;
     }
 
@@ -62,19 +84,31 @@ bool Client::connect(const std::string& host, int port) {
 #ifdef _WIN32
         int err = WSAGetLastError();
         if (err != WSAEWOULDBLOCK) {
-            std::cerr << "Error connecting to " << host << ":" << port << " (Win Error: " << err << ")" << std::endl;
+            logging::error("Error connecting to %s:%d (Win Error: %d)", host.c_str(), port, err);
             closesocket(socket_fd);
             socket_fd = INVALID_SOCKET_VAL;
             return false;
         }
 #else
-        std::cerr << "Error connecting to " << host << ":" << port << std::endl;
+        logging::error("Error connecting to %s:%d", host.c_str(), port);
         close(socket_fd);
         socket_fd = INVALID_SOCKET_VAL;
         return false;
 #endif
     }
 
+#ifdef SO_TIMESTAMPNS
+    // Kernel receive timestamps, so notify latency includes the time the
+    // data sat in the socket before this thread got to run
+    int stampOn = 1;
+    setsockopt(socket_fd, SOL_SOCKET, SO_TIMESTAMPNS, &stampOn, sizeof(stampOn));
+#endif
+
+    // Shares are single small writes; Nagle would hold one back until the
+    // previous write is acked
+    int noDelay = 1;
+    setsockopt(socket_fd, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+
     // Set non-blocking
 #ifdef _WIN32
     u_long mode = 1;
@@ -85,11 +119,22 @@ bool Client::connect(const std::string& host, int port) {
 #endif
 
     connected = true;
-    std::cout << "Connected to " << host << ":" << port << std::endl;
+    // The Electron front end watches stdout for this line
+    logging::status("Connected to %s:%d", host.c_str(), port);
     return true;
 }
 
 void Client::disconnect() {
+    // Waits out a flush in progress on another thread; unsent messages
+    // belong to this connection and are dropped
+    std::lock_guard<InstrumentedMutex> sendLock(sendMutex);
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex);
+        outboundHead = outboundTail;
+    }
+    outboundOffset = 0;
+    wantWrite = false;
+
     if (socket_fd != INVALID_SOCKET_VAL) {
 #ifdef _WIN32
         closesocket(socket_fd);
@@ -105,90 +150,376 @@ bool Client::isConnected() const {
     return connected;
 }
 
+// recv() that also reports when the data arrived, from SO_TIMESTAMPNS where
+// the platform has it (mapped from CLOCK_REALTIME onto the steady clock)
+static ssize_t_compat recvStamped(socket_t fd, char* buffer, size_t len,
+                                  std::chrono::steady_clock::time_point& at) {
+    at = std::chrono::steady_clock::now();
+#ifdef SO_TIMESTAMPNS
+    char control[CMSG_SPACE(sizeof(struct timespec))];
+    struct iovec iov = { buffer, len };
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof(control);
+
+    ssize_t_compat n = recvmsg(fd, &msg, 0);
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); n > 0 && c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec stamp, now;
+            std::memcpy(&stamp, CMSG_DATA(c), sizeof(stamp));
+            clock_gettime(CLOCK_REALTIME, &now);
+            int64_t ageNs = (int64_t)(now.tv_sec - stamp.tv_sec) * 1000000000LL + (now.tv_nsec - stamp.tv_nsec);
+            if (ageNs > 0) at -= std::chrono::nanoseconds(ageNs);
+        }
+    }
+    return n;
+#else
+    return recv(fd, buffer, (int)len, 0);
+#endif
+}
+
 void Client::process() {
     if (!connected || socket_fd < 0) return;
 
-    char buffer[4096];
-    ssize_t_compat n = recv(socket_fd, buffer, sizeof(buffer) - 1, 0);
+    // Drain everything the socket holds, so a burst costs one wakeup
+    for (;;) {
+        size_t room = recvLines.writable();
+        ssize_t_compat n = recvStamped(socket_fd, recvLines.writePtr(), room, recvAt);
+
+        if (n > 0) {
+            instrument::AllocationScope allocScope(instrument::Subsystem::Network);
+            recvLines.commit((size_t)n);
+            handleLines();
+            if (!connected) return;
+        } else if (n == 0) {
+            // Connection closed
+            logging::warn("Connection closed by server");
+            disconnect();
+            return;
+        } else {
+            // Error or EWOULDBLOCK
+#ifdef _WIN32
+            int err = WSAGetLastError();
+            if (err != WSAEWOULDBLOCK) {
+                 logging::error("Socket error: %d", err);
+                 disconnect();
+            }
+#else
+            if (errno == EINTR) continue;
+            if (errno != EWOULDBLOCK && errno != EAGAIN) {
+                 logging::error("Socket error: %s", strerror(errno));
+                 disconnect();
+            }
+#endif
+            return;
+        }
+    }
+}
 
-    if (n > 0) {
-        buffer[n] = 0;
-        recvBuffer.append(buffer);
+bool Client::run() {
+#ifdef __linux__
+    int epollFd = epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd < 0) {
+        logging::error("epoll_create1 failed: %s", strerror(errno));
+        return false;
+    }
+    struct epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = wakeFd;
+    if (wakeFd >= 0) epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+    ev.events = EPOLLIN | EPOLLRDHUP;
+    ev.data.fd = socket_fd;
+    if (connected && epoll_ctl(epollFd, EPOLL_CTL_ADD, socket_fd, &ev) < 0) {
+        logging::error("epoll_ctl failed: %s", strerror(errno));
+        close(epollFd);
+        return false;
+    }
 
-        // Process lines
-        size_t pos = 0;
-        while ((pos = recvBuffer.find('\n')) != std::string::npos) {
-            std::string line = recvBuffer.substr(0, pos);
-            recvBuffer.erase(0, pos + 1);
-            if (!line.empty()) {
-                handleMessage(line);
-            }
+    struct epoll_event events[2];
+    bool writeArmed = false;
+    while (!stopRequested && connected) {
+        // Poll for writability only while the outbound queue is blocked
+        bool pendingWrite = wantWrite;
+        if (pendingWrite != writeArmed) {
+            ev.events = EPOLLIN | EPOLLRDHUP | (pendingWrite ? (uint32_t)EPOLLOUT : 0u);
+            epoll_ctl(epollFd, EPOLL_CTL_MOD, socket_fd, &ev);
+            writeArmed = pendingWrite;
         }
-    } else if (n == 0) {
-        // Connection closed
-        std::cout << "Connection closed by server" << std::endl;
-        disconnect();
-    } else {
-        // Error or EWOULDBLOCK
-#ifdef _WIN32
-        int err = WSAGetLastError();
-        if (err != WSAEWOULDBLOCK) {
-             std::cerr << "Socket error: " << err << std::endl;
-             disconnect();
+
+        int n = epoll_wait(epollFd, events, 2, -1);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            logging::error("epoll_wait failed: %s", strerror(errno));
+            break;
         }
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.fd == wakeFd) {
+                uint64_t count;
+                while (read(wakeFd, &count, sizeof(count)) > 0) {}
+            } else {
+                if (events[i].events & EPOLLOUT) {
+                    wantWrite = false;
+                    flushOutbound();
+                }
+                // Errors and hang-ups surface through recv() as well
+                if (events[i].events & ~EPOLLOUT) process();
+            }
+        }
+    }
+    close(epollFd);
 #else
-        if (errno != EWOULDBLOCK && errno != EAGAIN) {
-             std::cerr << "Socket error: " << strerror(errno) << std::endl;
-             disconnect();
+    while (!stopRequested && connected) {
+        fd_set readable, writable;
+        FD_ZERO(&readable);
+        FD_ZERO(&writable);
+        FD_SET(socket_fd, &readable);
+        bool pendingWrite = wantWrite;
+        if (pendingWrite) FD_SET(socket_fd, &writable);
+        struct timeval timeout = { 0, 100000 };
+        int n = select((int)socket_fd + 1, &readable, pendingWrite ? &writable : nullptr, nullptr, &timeout);
+        if (n > 0 && FD_ISSET(socket_fd, &writable)) {
+            wantWrite = false;
+            flushOutbound();
         }
+        if (n > 0 && FD_ISSET(socket_fd, &readable)) process();
+    }
 #endif
+    return stopRequested;
+}
+
+void Client::stop() {
+    stopRequested = true;
+    wake();
+}
+
+void Client::wake() {
+#ifdef __linux__
+    if (wakeFd >= 0) {
+        uint64_t one = 1;
+        ssize_t ignored = write(wakeFd, &one, sizeof(one));
+        (void)ignored;
+    }
+#endif
+}
+
+void Client::feed(const char* data, size_t len) {
+    instrument::AllocationScope allocScope(instrument::Subsystem::Network);
+    while (len > 0) {
+        size_t chunk = std::min(len, recvLines.writable());
+        std::memcpy(recvLines.writePtr(), data, chunk);
+        recvLines.commit(chunk);
+        data += chunk;
+        len -= chunk;
+        handleLines();
+    }
+}
+
+void Client::handleLines() {
+    uint64_t overflows = recvLines.overflows();
+    std::string_view line;
+    while (recvLines.nextLine(line)) {
+        if (line.empty()) continue;
+        handleMessage(line);
+        if (recvAt != std::chrono::steady_clock::time_point()) {
+            latency::record(latency::Stage::ReadToHandled, std::chrono::steady_clock::now() - recvAt);
+        }
+    }
+    if (recvLines.overflows() != overflows) {
+        logging::warn("Dropped a message longer than %zu bytes", LineBuffer::kDefaultCapacity);
     }
 }
 
 bool Client::sendJson(cJSON* json) {
     if (!connected) return false;
+    instrument::AllocationScope allocScope(instrument::Subsystem::Network);
 
     char* str = cJSON_PrintUnformatted(json);
     if (!str) return false;
+    bool queued = enqueue(str, std::strlen(str));
+    free(str);
+    return queued;
+}
 
-    std::string msg = std::string(str) + "\n";
-    free(str); 
+bool Client::enqueue(const char* text, size_t len) {
+    if (!connected) return false;
+    if (len + 1 > kOutboundSlotBytes) {
+        logging::error("Outbound message of %zu bytes is too long", len);
+        return false;
+    }
+    {
+        std::lock_guard<std::mutex> lock(outboundMutex);
+        if (outboundTail - outboundHead >= kOutboundSlots) {
+            logging::warn("Outbound queue full, dropping message");
+            return false;
+        }
+        OutboundSlot& slot = outbound[outboundTail % kOutboundSlots];
+        std::memcpy(slot.text, text, len);
+        slot.text[len] = '\n';
+        slot.len = len + 1;
+        outboundTail++;
+    }
+    flushOutbound();
+    return true;
+}
 
-    std::lock_guard<std::mutex> lock(sendMutex);
-    
-    size_t totalSent = 0;
-    while (totalSent < msg.length()) {
-        ssize_t_compat n = send(socket_fd, msg.c_str() + totalSent, msg.length() - totalSent, 0);
-        
-        if (n < 0) {
 #ifdef _WIN32
-            int err = WSAGetLastError();
-            if (err == WSAEWOULDBLOCK) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                continue;
-            }
-            std::cerr << "Error sending data: " << err << std::endl;
+typedef WSABUF IoBuffer;
+static void setIoBuffer(IoBuffer& b, const char* data, size_t len) {
+    b.buf = (CHAR*)data;
+    b.len = (ULONG)len;
+}
 #else
-            if (errno == EAGAIN || errno == EWOULDBLOCK) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
-                continue;
-            }
-            std::cerr << "Error sending data: " << strerror(errno) << std::endl;
+typedef struct iovec IoBuffer;
+static void setIoBuffer(IoBuffer& b, const char* data, size_t len) {
+    b.iov_base = (void*)data;
+    b.iov_len = len;
+}
 #endif
-            return false;
+
+// Non-blocking scatter-gather send (sendmsg rather than writev so a closed
+// peer gives EPIPE instead of SIGPIPE); -1 with wouldBlock set on EAGAIN
+static ssize_t_compat sendGathered(socket_t fd, IoBuffer* buffers, size_t count, bool& wouldBlock) {
+    wouldBlock = false;
+#ifdef _WIN32
+    DWORD sent = 0;
+    if (WSASend(fd, buffers, (DWORD)count, &sent, 0, NULL, NULL) == SOCKET_ERROR) {
+        int err = WSAGetLastError();
+        if (err == WSAEWOULDBLOCK) wouldBlock = true;
+        else logging::error("Error sending data: %d", err);
+        return -1;
+    }
+    return (ssize_t_compat)sent;
+#else
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = buffers;
+    msg.msg_iovlen = count;
+#ifdef MSG_NOSIGNAL
+    ssize_t_compat n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+#else
+    ssize_t_compat n = sendmsg(fd, &msg, 0);
+#endif
+    if (n < 0) {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) wouldBlock = true;
+        else logging::error("Error sending data: %s", strerror(errno));
+    }
+    return n;
+#endif
+}
+
+void Client::flushOutbound() {
+    for (;;) {
+        // Someone else is flushing and will pick up what we queued
+        if (!sendMutex.try_lock()) return;
+
+        bool blocked = false;
+        for (;;) {
+            uint64_t head, tail;
+            {
+                std::lock_guard<std::mutex> lock(outboundMutex);
+                head = outboundHead;
+                tail = outboundTail;
+            }
+            if (head == tail || socket_fd == INVALID_SOCKET_VAL) break;
+
+            IoBuffer buffers[kOutboundSlots];
+            size_t count = 0;
+            for (uint64_t i = head; i < tail; i++) {
+                const OutboundSlot& slot = outbound[i % kOutboundSlots];
+                size_t offset = i == head ? outboundOffset : 0;
+                setIoBuffer(buffers[count++], slot.text + offset, slot.len - offset);
+            }
+
+            bool wouldBlock = false;
+            ssize_t_compat sent = sendGathered(socket_fd, buffers, count, wouldBlock);
+            if (sent < 0) {
+                if (wouldBlock) {
+                    blocked = true;
+                } else {
+                    // The receive side notices the dead connection; drop
+                    // what cannot be sent rather than retrying it
+                    std::lock_guard<std::mutex> lock(outboundMutex);
+                    outboundHead = outboundTail;
+                    outboundOffset = 0;
+                }
+                break;
+            }
+
+            // Retire fully sent slots; a partial write means the socket
+            // buffer is full
+            size_t left = (size_t)sent;
+            size_t offset = outboundOffset;
+            while (head < tail && left >= outbound[head % kOutboundSlots].len - offset) {
+                left -= outbound[head % kOutboundSlots].len - offset;
+                offset = 0;
+                head++;
+            }
+            outboundOffset = offset + left;
+            {
+                std::lock_guard<std::mutex> lock(outboundMutex);
+                outboundHead = head;
+            }
+            if (head != tail) {
+                blocked = true;
+                break;
+            }
+        }
+        sendMutex.unlock();
+
+        if (blocked) {
+            wantWrite = true;
+            wake();
+            return;
         }
-        totalSent += n;
+        // A message queued after our last look found us busy; send it now
+        std::lock_guard<std::mutex> lock(outboundMutex);
+        if (outboundHead == outboundTail) return;
     }
-    
-    return true;
 }
 
-void Client::handleMessage(const std::string& line) {
-    std::cout << "RECV: " << line << std::endl;
+// Stratum errors come as [code, message, data] or {code, message}; code 21
+// is "job not found", which pools also use for shares of a replaced job
+static bool isStaleError(cJSON* error) {
+    cJSON* code = nullptr;
+    cJSON* message = nullptr;
+    if (cJSON_IsArray(error)) {
+        code = cJSON_GetArrayItem(error, 0);
+        message = cJSON_GetArrayItem(error, 1);
+    } else if (cJSON_IsObject(error)) {
+        code = cJSON_GetObjectItem(error, "code");
+        message = cJSON_GetObjectItem(error, "message");
+    }
+    if (cJSON_IsNumber(code) && code->valueint == 21) return true;
+    return cJSON_IsString(message) && message->valuestring && mentionsStale(message->valuestring);
+}
+
+void Client::handleMessage(std::string_view line) {
+    logging::debug("RECV: %.*s", (int)line.size(), line.data());
+
+    // Notifies, difficulty changes and share acks skip cJSON entirely
+    FastMessage fast;
+    if (parseFastMessage(line, fast)) {
+        switch (fast.kind) {
+            case FastMessage::Kind::Notify:
+                onNotify(fast.jobId, fast.header, sizeof(fast.header), fast.timestamp);
+                break;
+            case FastMessage::Kind::SetDifficulty:
+                onSetDifficulty(fast.difficulty);
+                break;
+            case FastMessage::Kind::Response:
+                onResponse(fast.id, fast.accepted, false, fast.stale);
+                break;
+        }
+        return;
+    }
     
-    cJSON* json = cJSON_Parse(line.c_str());
+    cJSON* json = cJSON_ParseWithLength(line.data(), line.size());
     if (!json) {
-        std::cerr << "Failed to parse JSON: " << line << std::endl;
+        logging::warn("Failed to parse JSON: %.*s", (int)line.size(), line.data());
         return;
     }
     
@@ -199,15 +530,15 @@ void Client::handleMessage(const std::string& line) {
         
         // KASPA PROTOCOL: mining.notify(jobId, headerHash, timestamp)
         if (method == "mining.notify" && params && cJSON_GetArraySize(params) >= 3) {
-            Job job;
             cJSON* jId = cJSON_GetArrayItem(params, 0);
-            job.jobId = jId->valuestring ? jId->valuestring : "";
+            const char* jobId = jId->valuestring ? jId->valuestring : "";
             
             // Param 1: Header Hash (Pre-Pow) - 32 bytes hex OR array of 4 uint64s
+            std::vector<uint8_t> header;
             cJSON* headerParam = cJSON_GetArrayItem(params, 1);
             if (cJSON_IsArray(headerParam)) {
                 // It's [u64, u64, u64, u64]
-                job.header.resize(32);
+                header.resize(32);
                 for (int i = 0; i < 4 && i < cJSON_GetArraySize(headerParam); i++) {
                      cJSON* item = cJSON_GetArrayItem(headerParam, i);
                      uint64_t val = 0;
@@ -215,43 +546,24 @@ void Client::handleMessage(const std::string& line) {
                      else if(cJSON_IsString(item) && item->valuestring) val = strtoull(item->valuestring, NULL, 10);
                      
                      // Little Endian in Kaspa
-                     memcpy(job.header.data() + (i * 8), &val, 8);
+                     memcpy(header.data() + (i * 8), &val, 8);
                 }
             } else if (cJSON_IsString(headerParam) && headerParam->valuestring) {
-                job.header = hexToBytes(headerParam->valuestring);
+                header = hexToBytes(headerParam->valuestring);
             }
             
             // Param 2: Timestamp
+            uint64_t timestamp = 0;
             cJSON* tsParam = cJSON_GetArrayItem(params, 2);
-            if (cJSON_IsNumber(tsParam)) job.timestamp = (uint64_t)tsParam->valuedouble;
-            else if (cJSON_IsString(tsParam) && tsParam->valuestring) job.timestamp = strtoull(tsParam->valuestring, NULL, 10);
-            
-            job.cleanJobs = true;
-            
-            // Generate Target from currentDifficulty 
-            // Kaspa target: 2^255 / difficulty => simplified for byte array
-            job.target = std::vector<uint8_t>(32, 0xFF);
-            double diff = currentDifficulty > 0 ? currentDifficulty : 1.0;
+            if (cJSON_IsNumber(tsParam)) timestamp = (uint64_t)tsParam->valuedouble;
+            else if (cJSON_IsString(tsParam) && tsParam->valuestring) timestamp = strtoull(tsParam->valuestring, NULL, 10);
             
-            // This is a naive conversion for basic CPU mining testing purposes.
-            // If difficulty > 1, we add more leading zeros.
-            // Kaspa base diff 1 is usually something like 0x00 0x00 0xFF ...
-            if (diff >= 1000) { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; job.target[3] = 0; job.target[4] = 0; job.target[5] = 0; }
-            else if (diff >= 100) { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; job.target[3] = 0; }
-            else if (diff >= 10) { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; }
-            else { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; } // Default moderate diff instead of fake diff 1
-            
-            std::cout << "Received Job: " << job.jobId << " (Diff: " << diff << ")" << std::endl;
-            
-            if (jobCallback) {
-                jobCallback(job);
-            }
+            onNotify(jobId, header.data(), header.size(), timestamp);
         }
         else if (method == "mining.set_difficulty" && params && cJSON_GetArraySize(params) > 0) {
             cJSON* diffParam = cJSON_GetArrayItem(params, 0);
             if (cJSON_IsNumber(diffParam)) {
-                currentDifficulty = diffParam->valuedouble;
-                std::cout << "Pool set difficulty to: " << currentDifficulty << std::endl;
+                onSetDifficulty(diffParam->valuedouble);
             }
         }
     }
@@ -259,19 +571,84 @@ void Client::handleMessage(const std::string& line) {
     // Check for result (response to login/submit/subscribe)
     if (cJSON_GetObjectItem(json, "result")) {
         cJSON* result = cJSON_GetObjectItem(json, "result");
-        
-        if (cJSON_IsArray(result)) {
-             // Just accept it
-             std::cout << "Subscribed!" << std::endl;
-        }
-        else if (cJSON_IsTrue(result)) {
-             std::cout << "Stratum: Share Accepted by Pool!" << std::endl;
-        }
+        cJSON* id = cJSON_GetObjectItem(json, "id");
+        uint64_t requestId = cJSON_IsNumber(id) ? (uint64_t)id->valuedouble : 0;
+        onResponse(requestId, cJSON_IsTrue(result), cJSON_IsArray(result),
+                   isStaleError(cJSON_GetObjectItem(json, "error")));
     }
     
     cJSON_Delete(json);
 }
 
+void Client::onNotify(std::string_view jobId, const uint8_t* header, size_t headerLen, uint64_t timestamp) {
+    // One Job reused for every notify, so its strings and vectors keep
+    // their capacity and a steady stream of notifies allocates nothing here
+    Job& job = notifyJob;
+    job.receivedAt = recvAt;
+    job.jobId.assign(jobId.data(), jobId.size());
+    job.header.assign(header, header + headerLen);
+    job.timestamp = timestamp;
+    job.cleanJobs = true;
+    
+    // Generate Target from currentDifficulty 
+    // Kaspa target: 2^255 / difficulty => simplified for byte array
+    job.target.assign(32, 0xFF);
+    double diff = currentDifficulty > 0 ? currentDifficulty : 1.0;
+    
+    // This is a naive conversion for basic CPU mining testing purposes.
+    // If difficulty > 1, we add more leading zeros.
+    // Kaspa base diff 1 is usually something like 0x00 0x00 0xFF ...
+    if (diff >= 1000) { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; job.target[3] = 0; job.target[4] = 0; job.target[5] = 0; }
+    else if (diff >= 100) { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; job.target[3] = 0; }
+    else if (diff >= 10) { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; }
+    else { job.target[0] = 0; job.target[1] = 0; job.target[2] = 0; } // Default moderate diff instead of fake diff 1
+    
+    logging::info("Received Job: %s (Diff: %g)", job.jobId.c_str(), diff);
+    trace::recordAt(trace::Event::NotifyReceived,
+                    job.receivedAt != std::chrono::steady_clock::time_point() ? job.receivedAt
+                                                                              : std::chrono::steady_clock::now(),
+                    job.jobId.c_str());
+    
+    if (jobCallback) {
+        jobCallback(job);
+    }
+}
+
+void Client::onSetDifficulty(double difficulty) {
+    currentDifficulty = difficulty;
+    logging::info("Pool set difficulty to: %g", currentDifficulty);
+}
+
+void Client::onResponse(uint64_t requestId, bool accepted, bool subscribed, bool stale) {
+    trace::record(trace::Event::ResponseReceived, accepted || subscribed ? "accepted" : "rejected", requestId);
+
+    bool wasSubmit = false;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (auto it = pendingSubmits.begin(); it != pendingSubmits.end(); ++it) {
+            if (it->first == requestId) {
+                latency::record(latency::Stage::SubmitToAck, std::chrono::steady_clock::now() - it->second);
+                pendingSubmits.erase(it);
+                wasSubmit = true;
+                break;
+            }
+        }
+    }
+    if (wasSubmit) {
+        if (accepted) sharesAccepted++;
+        else if (stale) sharesStale++;
+        else sharesRejected++;
+    }
+    
+    if (subscribed) {
+         // Just accept it
+         logging::info("Subscribed!");
+    }
+    else if (accepted) {
+         logging::info("Stratum: Share Accepted by Pool!");
+    }
+}
+
 bool Client::subscribe(const std::string& userAgent) {
     cJSON* root = cJSON_CreateObject();
     cJSON_AddNumberToObject(root, "id", 1);
@@ -301,30 +678,88 @@ bool Client::login(const std::string& user, const std::string& password) {
     return result;
 }
 
-bool Client::submit(const std::string& jobId, uint32_t ntime, uint64_t nonce, uint64_t extraNonce2) {
-    cJSON* root = cJSON_CreateObject();
-    cJSON_AddNumberToObject(root, "id", 4);
-    cJSON_AddStringToObject(root, "method", "mining.submit");
-
-    // Bridge expects: [workerName, jobId, nonceHex]
-    cJSON* params = cJSON_CreateArray();
-    cJSON_AddItemToArray(params, cJSON_CreateString("generic"));
-    cJSON_AddItemToArray(params, cJSON_CreateString(jobId.c_str()));
+// Appends text as a JSON string body, escaped the way cJSON prints it;
+// false if it does not fit
+static bool appendJsonString(char*& out, const char* end, const std::string& text) {
+    static const char kHex[] = "0123456789abcdef";
+    for (unsigned char c : text) {
+        char escaped = 0;
+        switch (c) {
+            case '"': escaped = '"'; break;
+            case '\\': escaped = '\\'; break;
+            case '\b': escaped = 'b'; break;
+            case '\f': escaped = 'f'; break;
+            case '\n': escaped = 'n'; break;
+            case '\r': escaped = 'r'; break;
+            case '\t': escaped = 't'; break;
+        }
+        size_t need = escaped ? 2 : c < 0x20 ? 6 : 1;
+        if ((size_t)(end - out) < need) return false;
+        if (escaped) {
+            *out++ = '\\';
+            *out++ = escaped;
+        } else if (c < 0x20) {
+            std::memcpy(out, "\\u00", 4);
+            out[4] = kHex[c >> 4];
+            out[5] = kHex[c & 0xF];
+            out += 6;
+        } else {
+            *out++ = (char)c;
+        }
+    }
+    return true;
+}
 
-    // FIX: Buffer was 32 bytes — too small when assembled with the JSON string,
-    // causing truncation that dropped the closing "}" bracket and triggered
-    // "unexpected end of JSON input" disconnects in the stratum bridge.
-    char nonceHex[64];
-    snprintf(nonceHex, sizeof(nonceHex), "%016llx", (long long unsigned int)nonce);
-    cJSON_AddItemToArray(params, cJSON_CreateString(nonceHex));
+bool Client::submit(const std::string& jobId, uint32_t ntime, uint64_t nonce, uint64_t extraNonce2) {
+    // Called from worker threads; the request is network traffic all the same
+    instrument::AllocationScope allocScope(instrument::Subsystem::Network);
+    uint64_t id = nextSubmitId++;
+
+    // Rendered on the stack from a fixed template, byte for byte what cJSON
+    // printed. Bridge expects: [workerName, jobId, nonceHex]
+    char line[kOutboundSlotBytes];
+    char* out = line;
+    const char* end = line + sizeof(line);
+    out += snprintf(out, (size_t)(end - out), "{\"id\":%llu,\"method\":\"mining.submit\",\"params\":[\"generic\",\"",
+                    (unsigned long long)id);
+    if (!appendJsonString(out, end, jobId) || (size_t)(end - out) < 24) {
+        logging::error("Job id too long to submit: %zu bytes", jobId.size());
+        return false;
+    }
+    out += snprintf(out, (size_t)(end - out), "\",\"%016llx\"]}", (unsigned long long)nonce);
 
-    cJSON_AddItemToObject(root, "params", params);
+    // Registered before sending: the ack can be handled before send() returns
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        if (pendingSubmits.size() >= kMaxPendingSubmits) pendingSubmits.pop_front();
+        pendingSubmits.emplace_back(id, std::chrono::steady_clock::now());
+    }
 
-    bool result = sendJson(root);
-    cJSON_Delete(root);
+    bool result = enqueue(line, (size_t)(out - line));
+    if (result) {
+        sharesSubmitted++;
+        trace::record(trace::Event::SubmitQueued, jobId.c_str(), nonce);
+    } else {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        for (auto it = pendingSubmits.begin(); it != pendingSubmits.end(); ++it) {
+            if (it->first == id) {
+                pendingSubmits.erase(it);
+                break;
+            }
+        }
+    }
     return result;
 }
 
+ShareCounts Client::shareCounts() const {
+    ShareCounts counts;
+    counts.submitted = sharesSubmitted.load();
+    counts.accepted = sharesAccepted.load();
+    counts.rejected = sharesRejected.load();
+    counts.stale = sharesStale.load();
+    return counts;
+}
+
 void Client::onJob(std::function<void(const Job&)> callback) {
     jobCallback = callback;
 }
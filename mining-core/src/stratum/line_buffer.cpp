@@ -0,0 +1,64 @@
+#include "../../include/line_buffer.h"
+#include <cstring>
+
+namespace kuzadesign {
+namespace stratum {
+
+LineBuffer::LineBuffer(size_t capacity)
+    : m_data(new char[capacity > 0 ? capacity : 1]), m_capacity(capacity > 0 ? capacity : 1) {}
+
+void LineBuffer::compact() {
+    if (m_start > 0) {
+        size_t remaining = m_end - m_start;
+        if (remaining > 0) std::memmove(m_data.get(), m_data.get() + m_start, remaining);
+        m_scan -= m_start;
+        m_end = remaining;
+        m_start = 0;
+    }
+    // Full of a single unterminated line: drop it and skip to its newline
+    if (m_end == m_capacity) {
+        m_start = m_scan = m_end = 0;
+        if (!m_discarding) m_overflows++;
+        m_discarding = true;
+    }
+}
+
+char* LineBuffer::writePtr() {
+    compact();
+    return m_data.get() + m_end;
+}
+
+size_t LineBuffer::writable() {
+    compact();
+    return m_capacity - m_end;
+}
+
+void LineBuffer::commit(size_t n) {
+    m_end += n <= m_capacity - m_end ? n : m_capacity - m_end;
+}
+
+bool LineBuffer::nextLine(std::string_view& line) {
+    for (;;) {
+        const char* base = m_data.get();
+        const void* found = m_scan < m_end ? std::memchr(base + m_scan, '\n', m_end - m_scan) : nullptr;
+        if (!found) {
+            m_scan = m_end;
+            if (m_discarding) m_start = m_end;
+            return false;
+        }
+        size_t newline = (size_t)((const char*)found - base);
+        size_t begin = m_start;
+        m_start = m_scan = newline + 1;
+        if (m_discarding) {
+            m_discarding = false;
+            continue;
+        }
+        size_t end = newline;
+        if (end > begin && base[end - 1] == '\r') end--;
+        line = std::string_view(base + begin, end - begin);
+        return true;
+    }
+}
+
+} // namespace stratum
+} // namespace kuzadesign
@@ -1,11 +1,304 @@
-#include "../../include/stratum.h"
-#include <iostream>
+#include "../../include/protocol.h"
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
 
 namespace kuzadesign {
 namespace stratum {
 
-// Protocol handling logic (parsing job, etc.) will go here
-// Currently mostly in client.cpp or handled inline
+namespace {
+
+constexpr int kMaxDepth = 8;
+
+// Forward-only JSON scanner over a line. Every method skips leading
+// whitespace and returns false, leaving the position unspecified, when
+// the input does not have the expected shape.
+struct Cursor {
+    const char* p;
+    const char* end;
+
+    void skipSpace() {
+        while (p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')) p++;
+    }
+
+    bool peek(char c) {
+        skipSpace();
+        return p < end && *p == c;
+    }
+
+    bool eat(char c) {
+        if (!peek(c)) return false;
+        p++;
+        return true;
+    }
+
+    bool literal(const char* word) {
+        skipSpace();
+        size_t len = std::strlen(word);
+        if ((size_t)(end - p) < len || std::memcmp(p, word, len) != 0) return false;
+        p += len;
+        return true;
+    }
+
+    // Strings with escapes are left to cJSON
+    bool string(std::string_view& out) {
+        if (!eat('"')) return false;
+        const char* close = (const char*)std::memchr(p, '"', (size_t)(end - p));
+        if (!close || std::memchr(p, '\\', (size_t)(close - p))) return false;
+        out = std::string_view(p, (size_t)(close - p));
+        p = close + 1;
+        return true;
+    }
+
+    // Plain non-negative integer (no sign, fraction or exponent)
+    bool integer(uint64_t& value) {
+        skipSpace();
+        const char* start = p;
+        value = 0;
+        while (p < end && *p >= '0' && *p <= '9') {
+            uint64_t digit = (uint64_t)(*p - '0');
+            if (value > (UINT64_MAX - digit) / 10) return false;
+            value = value * 10 + digit;
+            p++;
+        }
+        if (p == start) return false;
+        return p >= end || (*p != '.' && *p != 'e' && *p != 'E');
+    }
+
+    // Integer given either as a number or as a string of digits
+    bool integerOrDigits(uint64_t& value) {
+        if (!peek('"')) return integer(value);
+        std::string_view digits;
+        if (!string(digits) || digits.empty()) return false;
+        Cursor inner{ digits.data(), digits.data() + digits.size() };
+        return inner.integer(value) && inner.p == inner.end;
+    }
+
+    static bool numberChar(char c) {
+        return (c >= '0' && c <= '9') || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E';
+    }
+
+    bool number(double& value) {
+        skipSpace();
+        char text[64];
+        size_t len = 0;
+        while (p < end && len < sizeof(text) - 1 && numberChar(*p)) text[len++] = *p++;
+        if (len == 0 || len == sizeof(text) - 1) return false;
+        text[len] = '\0';
+        char* parsed = nullptr;
+        value = std::strtod(text, &parsed);
+        return parsed == text + len;
+    }
+
+    // Only validated when it is actually read
+    bool skipNumber() {
+        const char* start = p;
+        while (p < end && numberChar(*p)) p++;
+        return p != start;
+    }
+
+    bool skipValue(int depth = 0) {
+        if (depth > kMaxDepth) return false;
+        skipSpace();
+        if (p >= end) return false;
+        std::string_view ignored;
+        switch (*p) {
+            case '"': return string(ignored);
+            case 't': return literal("true");
+            case 'f': return literal("false");
+            case 'n': return literal("null");
+            case '[':
+                p++;
+                if (eat(']')) return true;
+                do {
+                    if (!skipValue(depth + 1)) return false;
+                } while (eat(','));
+                return eat(']');
+            case '{':
+                p++;
+                if (eat('}')) return true;
+                do {
+                    if (!string(ignored) || !eat(':') || !skipValue(depth + 1)) return false;
+                } while (eat(','));
+                return eat('}');
+            default:
+                return skipNumber();
+        }
+    }
+
+    // Skips whatever is left of an array after the elements we read
+    bool finishArray() {
+        while (eat(',')) {
+            if (!skipValue(1)) return false;
+        }
+        return eat(']');
+    }
+};
+
+// Nibble value of each byte, 0xFF for non-hex characters
+struct HexTable {
+    uint8_t value[256];
+    HexTable() {
+        std::memset(value, 0xFF, sizeof(value));
+        for (int i = 0; i < 10; i++) value['0' + i] = (uint8_t)i;
+        for (int i = 0; i < 6; i++) value['a' + i] = value['A' + i] = (uint8_t)(10 + i);
+    }
+};
+const HexTable kHex;
+
+bool parseNotify(Cursor& c, FastMessage& message) {
+    if (!c.eat('[') || !c.string(message.jobId) || !c.eat(',')) return false;
+
+    std::memset(message.header, 0, sizeof(message.header));
+    if (c.peek('"')) {
+        std::string_view hex;
+        if (!c.string(hex) || hex.size() != 2 * sizeof(message.header)) return false;
+        for (size_t i = 0; i < sizeof(message.header); i++) {
+            uint8_t hi = kHex.value[(uint8_t)hex[2 * i]], lo = kHex.value[(uint8_t)hex[2 * i + 1]];
+            if ((hi | lo) & 0xF0) return false;
+            message.header[i] = (uint8_t)(hi << 4 | lo);
+        }
+    } else if (c.eat('[')) {
+        for (int i = 0; i < 4; i++) {
+            uint64_t word;
+            if ((i > 0 && !c.eat(',')) || !c.integerOrDigits(word)) return false;
+            // Little endian in Kaspa
+            std::memcpy(message.header + i * 8, &word, 8);
+        }
+        if (!c.eat(']')) return false;
+    } else {
+        return false;
+    }
+
+    if (!c.eat(',') || !c.integerOrDigits(message.timestamp)) return false;
+    message.kind = FastMessage::Kind::Notify;
+    return c.finishArray();
+}
+
+bool parseSetDifficulty(Cursor& c, FastMessage& message) {
+    if (!c.eat('[') || !c.number(message.difficulty)) return false;
+    message.kind = FastMessage::Kind::SetDifficulty;
+    return c.finishArray();
+}
+
+bool parseParams(std::string_view method, Cursor& c, FastMessage& message) {
+    if (method == "mining.notify") return parseNotify(c, message);
+    if (method == "mining.set_difficulty") return parseSetDifficulty(c, message);
+    return false;
+}
+
+// error: null, [code, message, ...] or {"code": n, "message": "..."}
+bool parseError(Cursor c, bool& stale) {
+    stale = false;
+    if (c.literal("null")) return true;
+
+    double code = 0.0;
+    std::string_view text;
+    if (c.eat('[')) {
+        if (c.eat(']')) return true;
+        std::string_view ignored;
+        if (c.peek('"') ? !c.string(ignored) : !c.literal("null") && !c.number(code)) return false;
+        if (c.eat(',')) {
+            if (c.peek('"')) {
+                if (!c.string(text)) return false;
+            } else if (!c.skipValue(1)) {
+                return false;
+            }
+            if (!c.finishArray()) return false;
+        } else if (!c.eat(']')) {
+            return false;
+        }
+    } else if (c.eat('{')) {
+        if (!c.eat('}')) {
+            do {
+                std::string_view key;
+                if (!c.string(key) || !c.eat(':')) return false;
+                if (key == "code" && !c.peek('"') && !c.peek('n')) {
+                    if (!c.number(code)) return false;
+                } else if (key == "message" && c.peek('"')) {
+                    if (!c.string(text)) return false;
+                } else if (!c.skipValue(1)) {
+                    return false;
+                }
+            } while (c.eat(','));
+            if (!c.eat('}')) return false;
+        }
+    } else {
+        return false;
+    }
+    stale = code == 21.0 || mentionsStale(text);
+    return true;
+}
+
+} // namespace
+
+bool mentionsStale(std::string_view text) {
+    static const char kWord[] = "stale";
+    const size_t len = sizeof(kWord) - 1;
+    for (size_t i = 0; i + len <= text.size(); i++) {
+        size_t j = 0;
+        while (j < len && std::tolower((unsigned char)text[i + j]) == kWord[j]) j++;
+        if (j == len) return true;
+    }
+    return false;
+}
+
+bool parseFastMessage(std::string_view line, FastMessage& message) {
+    Cursor c{ line.data(), line.data() + line.size() };
+    if (!c.eat('{') || c.eat('}')) return false;
+
+    std::string_view method;
+    bool hasMethod = false, hasResult = false, hasError = false, paramsParsed = false;
+    Cursor params{ nullptr, nullptr }, error{ nullptr, nullptr };
+    message.id = 0;
+    message.accepted = false;
+
+    do {
+        std::string_view key;
+        if (!c.string(key) || !c.eat(':')) return false;
+        if (key == "id") {
+            if (!c.literal("null") && !c.integer(message.id)) return false;
+        } else if (key == "method") {
+            if (!c.string(method)) return false;
+            hasMethod = true;
+        } else if (key == "params") {
+            // Pools send the method first; then params need only one pass
+            if (hasMethod && !paramsParsed) {
+                if (!parseParams(method, c, message)) return false;
+                paramsParsed = true;
+            } else {
+                c.skipSpace();
+                params = c;
+                if (!c.skipValue()) return false;
+            }
+        } else if (key == "result") {
+            if (c.literal("true")) message.accepted = true;
+            else if (!c.literal("false") && !c.literal("null")) return false;
+            hasResult = true;
+        } else if (key == "error") {
+            c.skipSpace();
+            error = c;
+            hasError = true;
+            if (!c.skipValue()) return false;
+        } else if (!c.skipValue()) {
+            return false;
+        }
+    } while (c.eat(','));
+    if (!c.eat('}')) return false;
+    c.skipSpace();
+    if (c.p != c.end) return false;
+
+    if (hasMethod) {
+        if (hasResult) return false;
+        if (paramsParsed) return true;
+        return params.p && parseParams(method, params, message);
+    }
+    if (!hasResult) return false;
+
+    message.kind = FastMessage::Kind::Response;
+    message.stale = false;
+    return !hasError || parseError(error, message.stale);
+}
 
 } // namespace stratum
 } // namespace kuzadesign
@@ -0,0 +1,390 @@
+#include "topology.h"
+#include <algorithm>
+#include <fstream>
+#include <set>
+#include <map>
+#include <tuple>
+#include <thread>
+#include <cstdlib>
+#include <cmath>
+#include <sstream>
+
+#ifdef _WIN32
+    #include <windows.h>
+#elif defined(__linux__)
+    #include <pthread.h>
+    #include <sched.h>
+    #include <sys/resource.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+namespace kuzadesign {
+
+static bool readFile(const std::string& path, std::string& out) {
+    std::ifstream file(path);
+    if (!file) return false;
+    std::getline(file, out);
+    while (!out.empty() && (out.back() == '\n' || out.back() == ' ' || out.back() == '\r')) {
+        out.pop_back();
+    }
+    return true;
+}
+
+static int readInt(const std::string& path, int fallback) {
+    std::string value;
+    if (!readFile(path, value) || value.empty()) return fallback;
+    return std::atoi(value.c_str());
+}
+
+std::vector<int> parseCpuList(const std::string& list) {
+    std::vector<int> cpus;
+    size_t pos = 0;
+    while (pos < list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) comma = list.size();
+        std::string item = list.substr(pos, comma - pos);
+        pos = comma + 1;
+        if (item.empty()) continue;
+
+        size_t dash = item.find('-');
+        int first = std::atoi(item.c_str());
+        int last = dash == std::string::npos ? first : std::atoi(item.c_str() + dash + 1);
+        for (int cpu = first; cpu <= last; cpu++) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+CpuTopology CpuTopology::discover(const std::string& sysRoot, const std::vector<int>& allowed) {
+    CpuTopology topo;
+
+    std::string online;
+    std::vector<int> cpuIds;
+    if (readFile(sysRoot + "/cpu/online", online)) {
+        cpuIds = parseCpuList(online);
+    }
+    if (cpuIds.empty()) {
+        // No sysfs (Windows, macOS, restricted containers): flat topology
+        unsigned n = std::thread::hardware_concurrency();
+        for (unsigned i = 0; i < (n ? n : 1); i++) cpuIds.push_back((int)i);
+    }
+    if (!allowed.empty()) {
+        std::set<int> mask(allowed.begin(), allowed.end());
+        cpuIds.erase(std::remove_if(cpuIds.begin(), cpuIds.end(),
+                                    [&mask](int cpu) { return !mask.count(cpu); }),
+                     cpuIds.end());
+        // sysfs disagrees with the mask entirely: trust the mask
+        if (cpuIds.empty()) cpuIds.assign(mask.begin(), mask.end());
+    }
+
+    for (int id : cpuIds) {
+        CpuInfo info;
+        info.cpu = id;
+        std::string base = sysRoot + "/cpu/cpu" + std::to_string(id) + "/topology/";
+        info.core = readInt(base + "core_id", id);
+        info.package = readInt(base + "physical_package_id", 0);
+        topo.m_cpus.push_back(info);
+    }
+
+    // NUMA nodes
+    std::string nodesOnline;
+    if (readFile(sysRoot + "/node/online", nodesOnline)) {
+        for (int node : parseCpuList(nodesOnline)) {
+            std::string cpulist;
+            if (!readFile(sysRoot + "/node/node" + std::to_string(node) + "/cpulist", cpulist)) continue;
+            for (int cpu : parseCpuList(cpulist)) {
+                for (auto& info : topo.m_cpus) {
+                    if (info.cpu == cpu) info.node = node;
+                }
+            }
+        }
+    }
+
+    // SMT sibling index: order of appearance within the same physical core
+    std::map<std::pair<int, int>, int> seen;
+    for (auto& info : topo.m_cpus) {
+        info.sibling = seen[{info.package, info.core}]++;
+    }
+
+    return topo;
+}
+
+int CpuTopology::nodeCount() const {
+    std::set<int> nodes;
+    for (const auto& info : m_cpus) nodes.insert(info.node);
+    return (int)nodes.size();
+}
+
+int CpuTopology::coreCount() const {
+    std::set<std::pair<int, int>> cores;
+    for (const auto& info : m_cpus) cores.insert({info.package, info.core});
+    return (int)cores.size();
+}
+
+int CpuTopology::nodeOf(int cpu) const {
+    for (const auto& info : m_cpus) {
+        if (info.cpu == cpu) return info.node;
+    }
+    return -1;
+}
+
+std::vector<int> CpuTopology::placement(PlacementPolicy policy, int node) const {
+    std::vector<CpuInfo> order = m_cpus;
+
+    auto byCore = [](const CpuInfo& a, const CpuInfo& b) {
+        return std::tie(a.node, a.package, a.core, a.sibling) <
+               std::tie(b.node, b.package, b.core, b.sibling);
+    };
+
+    switch (policy) {
+        case PlacementPolicy::None:
+            return {};
+
+        case PlacementPolicy::Compact:
+            std::sort(order.begin(), order.end(), byCore);
+            break;
+
+        case PlacementPolicy::Scatter: {
+            // Rank each core within its node so we can alternate nodes:
+            // node0/core0, node1/core0, node0/core1, ... then SMT siblings.
+            std::sort(order.begin(), order.end(), byCore);
+            std::map<int, int> nextRank;
+            std::map<std::pair<int, int>, int> coreRank;
+            for (const auto& info : order) {
+                auto key = std::make_pair(info.package, info.core);
+                if (!coreRank.count(key)) coreRank[key] = nextRank[info.node]++;
+            }
+            std::stable_sort(order.begin(), order.end(), [&](const CpuInfo& a, const CpuInfo& b) {
+                int ra = coreRank[{a.package, a.core}];
+                int rb = coreRank[{b.package, b.core}];
+                return std::tie(a.sibling, ra, a.node) < std::tie(b.sibling, rb, b.node);
+            });
+            break;
+        }
+
+        case PlacementPolicy::PhysicalCores:
+            order.erase(std::remove_if(order.begin(), order.end(),
+                                       [](const CpuInfo& info) { return info.sibling != 0; }),
+                        order.end());
+            std::sort(order.begin(), order.end(), byCore);
+            break;
+
+        case PlacementPolicy::NodeLocal: {
+            if (node < 0) {
+                node = order.empty() ? 0 : order.front().node;
+                for (const auto& info : order) node = std::min(node, info.node);
+            }
+            order.erase(std::remove_if(order.begin(), order.end(),
+                                       [node](const CpuInfo& info) { return info.node != node; }),
+                        order.end());
+            // Physical cores of the node first, then their siblings
+            std::sort(order.begin(), order.end(), [](const CpuInfo& a, const CpuInfo& b) {
+                return std::tie(a.sibling, a.package, a.core) < std::tie(b.sibling, b.package, b.core);
+            });
+            break;
+        }
+    }
+
+    std::vector<int> cpus;
+    for (const auto& info : order) cpus.push_back(info.cpu);
+    return cpus;
+}
+
+// Quota in CPUs from one cgroup directory, -1 if unlimited or absent
+static double readGroupQuota(const std::string& dir) {
+    std::string line;
+    if (readFile(dir + "/cpu.max", line)) {
+        // v2: "<quota|max> <period>"
+        std::istringstream in(line);
+        std::string quota;
+        double period = 0;
+        in >> quota >> period;
+        if (quota == "max" || period <= 0) return -1;
+        return std::atof(quota.c_str()) / period;
+    }
+
+    // v1: quota of -1 means unlimited
+    double quota = readInt(dir + "/cpu.cfs_quota_us", -1);
+    double period = readInt(dir + "/cpu.cfs_period_us", 0);
+    if (quota <= 0 || period <= 0) return -1;
+    return quota / period;
+}
+
+double cgroupCpuQuota(const std::string& cgroupRoot, const std::string& selfCgroupFile) {
+    // Candidate group directories: our own group and all its ancestors in
+    // each hierarchy, plus the root (which is our group inside a container
+    // with its own cgroup namespace).
+    std::vector<std::string> dirs;
+    std::ifstream self(selfCgroupFile);
+    std::string entry;
+    while (std::getline(self, entry)) {
+        // "<id>:<controllers>:<path>"
+        size_t first = entry.find(':');
+        size_t second = entry.find(':', first + 1);
+        if (first == std::string::npos || second == std::string::npos) continue;
+        std::string controllers = entry.substr(first + 1, second - first - 1);
+        std::string path = entry.substr(second + 1);
+
+        std::string mount;
+        if (controllers.empty()) mount = cgroupRoot;                        // v2
+        else if (controllers.find("cpu") == std::string::npos) continue;
+        else mount = cgroupRoot + "/" + controllers;                        // v1
+
+        while (!path.empty() && path != "/") {
+            dirs.push_back(mount + path);
+            path = path.substr(0, path.rfind('/'));
+        }
+        dirs.push_back(mount);
+    }
+    dirs.push_back(cgroupRoot);
+
+    double limit = -1;
+    for (const auto& dir : dirs) {
+        double quota = readGroupQuota(dir);
+        if (quota > 0 && (limit < 0 || quota < limit)) limit = quota;
+    }
+    return limit;
+}
+
+std::vector<int> affinityCpus() {
+    std::vector<int> cpus;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) cpus.push_back(cpu);
+        }
+    }
+#elif defined(_WIN32)
+    DWORD_PTR processMask = 0, systemMask = 0;
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask)) {
+        for (int cpu = 0; processMask; processMask >>= 1, cpu++) {
+            if (processMask & 1) cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+int affinityCpuCount() {
+    size_t count = affinityCpus().size();
+    if (count > 0) return (int)count;
+    unsigned n = std::thread::hardware_concurrency();
+    return n ? (int)n : 1;
+}
+
+int detectUsableCpus(double* quota) {
+    int cpus = affinityCpuCount();
+    double limit = -1;
+#ifdef __linux__
+    limit = cgroupCpuQuota();
+    if (limit > 0) {
+        cpus = std::min(cpus, (int)std::ceil(limit - 1e-6));
+    }
+#endif
+    if (quota) *quota = limit;
+    return std::max(1, cpus);
+}
+
+bool pinCurrentThread(int cpu) {
+    if (cpu < 0) return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    if (cpu >= 64) return false;
+    return SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) != 0;
+#else
+    return false;
+#endif
+}
+
+bool pinCurrentThread(const std::vector<int>& cpus) {
+    if (cpus.empty()) return false;
+#if defined(__linux__)
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < CPU_SETSIZE) CPU_SET(cpu, &set);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#elif defined(_WIN32)
+    DWORD_PTR mask = 0;
+    for (int cpu : cpus) {
+        if (cpu >= 0 && cpu < 64) mask |= (DWORD_PTR)1 << cpu;
+    }
+    return mask && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#else
+    return false;
+#endif
+}
+
+bool setCurrentThreadScheduling(SchedulingClass cls) {
+#if defined(__linux__)
+    if (cls == SchedulingClass::Idle) {
+        sched_param param{};
+        param.sched_priority = 0;
+        return pthread_setschedparam(pthread_self(), SCHED_IDLE, &param) == 0;
+    }
+    // Nice values are per thread on Linux (PRIO_PROCESS with a tid)
+    int nice = 0;
+    if (cls == SchedulingClass::Background) nice = 19;
+    if (cls == SchedulingClass::Elevated) nice = -10;
+    return setpriority(PRIO_PROCESS, (id_t)syscall(SYS_gettid), nice) == 0;
+#elif defined(_WIN32)
+    int priority = THREAD_PRIORITY_NORMAL;
+    if (cls == SchedulingClass::Background) priority = THREAD_PRIORITY_LOWEST;
+    if (cls == SchedulingClass::Idle) priority = THREAD_PRIORITY_IDLE;
+    if (cls == SchedulingClass::Elevated) priority = THREAD_PRIORITY_HIGHEST;
+    return SetThreadPriority(GetCurrentThread(), priority) != 0;
+#else
+    return cls == SchedulingClass::Normal;
+#endif
+}
+
+const char* placementPolicyName(PlacementPolicy policy) {
+    switch (policy) {
+        case PlacementPolicy::None: return "none";
+        case PlacementPolicy::Compact: return "compact";
+        case PlacementPolicy::Scatter: return "scatter";
+        case PlacementPolicy::PhysicalCores: return "physical";
+        case PlacementPolicy::NodeLocal: return "node";
+    }
+    return "none";
+}
+
+bool parsePlacementPolicy(const std::string& name, PlacementPolicy& policy) {
+    if (name == "none") policy = PlacementPolicy::None;
+    else if (name == "compact") policy = PlacementPolicy::Compact;
+    else if (name == "scatter") policy = PlacementPolicy::Scatter;
+    else if (name == "physical") policy = PlacementPolicy::PhysicalCores;
+    else if (name == "node") policy = PlacementPolicy::NodeLocal;
+    else return false;
+    return true;
+}
+
+const char* schedulingClassName(SchedulingClass cls) {
+    switch (cls) {
+        case SchedulingClass::Normal: return "normal";
+        case SchedulingClass::Background: return "background";
+        case SchedulingClass::Idle: return "idle";
+        case SchedulingClass::Elevated: return "elevated";
+    }
+    return "normal";
+}
+
+bool parseSchedulingClass(const std::string& name, SchedulingClass& cls) {
+    if (name == "normal") cls = SchedulingClass::Normal;
+    else if (name == "background") cls = SchedulingClass::Background;
+    else if (name == "idle") cls = SchedulingClass::Idle;
+    else if (name == "elevated") cls = SchedulingClass::Elevated;
+    else return false;
+    return true;
+}
+
+} // namespace kuzadesign
@@ -0,0 +1,213 @@
+#include "trace.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+extern "C" {
+#include "cJSON.h"
+}
+
+namespace kuzadesign {
+namespace trace {
+
+namespace {
+
+constexpr size_t kRingCapacity = 4096;      // Power of two
+constexpr size_t kMaxRings = 256;           // Beyond this, rings of exited threads are reused
+
+// Single producer (the owning thread). Readers copy concurrently and use
+// the head counter to discard slots that may have been overwritten while
+// they were being copied.
+struct Ring {
+    std::atomic<uint64_t> head{0};
+    Record records[kRingCapacity];
+    int tid = 0;
+    std::string name;
+    bool inUse = false;                     // Guarded by registryMutex
+};
+
+std::mutex registryMutex;
+std::vector<std::unique_ptr<Ring>> rings;
+std::atomic<bool> tracingEnabled{true};
+std::atomic<int> nextTid{1};
+
+Ring* acquireRing() {
+    std::lock_guard<std::mutex> lock(registryMutex);
+    Ring* ring = nullptr;
+    if (rings.size() >= kMaxRings) {
+        for (auto& candidate : rings) {
+            if (!candidate->inUse) {
+                ring = candidate.get();
+                ring->head.store(0, std::memory_order_relaxed);
+                break;
+            }
+        }
+    }
+    if (!ring) {
+        rings.push_back(std::unique_ptr<Ring>(new Ring()));
+        ring = rings.back().get();
+    }
+    ring->inUse = true;
+    ring->tid = nextTid++;
+    ring->name = "thread " + std::to_string(ring->tid);
+    return ring;
+}
+
+// Returns the ring to the pool when the thread exits; its events stay
+// readable until the ring is handed to another thread
+struct RingHandle {
+    Ring* ring = nullptr;
+    ~RingHandle() {
+        if (!ring) return;
+        std::lock_guard<std::mutex> lock(registryMutex);
+        ring->inUse = false;
+    }
+};
+
+thread_local RingHandle localRing;
+
+inline Ring* threadRing() {
+    if (!localRing.ring) localRing.ring = acquireRing();
+    return localRing.ring;
+}
+
+inline uint64_t toNs(std::chrono::steady_clock::time_point at) {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(at.time_since_epoch()).count();
+}
+
+} // namespace
+
+const char* eventName(Event event) {
+    switch (event) {
+        case Event::NotifyReceived: return "notify received";
+        case Event::JobPublished: return "job published";
+        case Event::JobPickedUp: return "job picked up";
+        case Event::CandidateFound: return "candidate found";
+        case Event::SubmitQueued: return "submit queued";
+        case Event::ResponseReceived: return "response received";
+    }
+    return "unknown";
+}
+
+void setEnabled(bool enabled) {
+    tracingEnabled.store(enabled, std::memory_order_relaxed);
+}
+
+bool enabled() {
+    return tracingEnabled.load(std::memory_order_relaxed);
+}
+
+void setThreadName(const std::string& name) {
+    Ring* ring = threadRing();
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ring->name = name;
+}
+
+void recordAt(Event event, std::chrono::steady_clock::time_point at, const char* tag, uint64_t arg) {
+    if (!tracingEnabled.load(std::memory_order_relaxed)) return;
+    Ring* ring = threadRing();
+
+    uint64_t head = ring->head.load(std::memory_order_relaxed);
+    Record& r = ring->records[head & (kRingCapacity - 1)];
+    r.ns = toNs(at);
+    r.arg = arg;
+    r.event = event;
+    if (tag) {
+        std::strncpy(r.tag, tag, sizeof(r.tag) - 1);
+        r.tag[sizeof(r.tag) - 1] = 0;
+    } else {
+        r.tag[0] = 0;
+    }
+    ring->head.store(head + 1, std::memory_order_release);
+}
+
+void record(Event event, const char* tag, uint64_t arg) {
+    recordAt(event, std::chrono::steady_clock::now(), tag, arg);
+}
+
+std::string chromeTraceJson() {
+    struct Snapshot {
+        int tid;
+        std::string name;
+        std::vector<Record> records;
+    };
+    std::vector<Snapshot> snapshots;
+    {
+        std::lock_guard<std::mutex> lock(registryMutex);
+        for (const auto& ring : rings) {
+            Snapshot snap;
+            snap.tid = ring->tid;
+            snap.name = ring->name;
+
+            // The slot after head may be mid-write, so a full ring yields
+            // its newest kRingCapacity - 1 events
+            uint64_t head = ring->head.load(std::memory_order_acquire);
+            uint64_t first = head >= kRingCapacity ? head + 1 - kRingCapacity : 0;
+            std::vector<Record> copy;
+            copy.reserve((size_t)(head - first));
+            for (uint64_t i = first; i < head; i++) {
+                copy.push_back(ring->records[i & (kRingCapacity - 1)]);
+            }
+            // Anything the writer lapped during the copy is unreliable,
+            // including the slot of event `after`, which may be mid-write
+            std::atomic_thread_fence(std::memory_order_acquire);
+            uint64_t after = ring->head.load(std::memory_order_relaxed);
+            uint64_t valid = after >= kRingCapacity ? after + 1 - kRingCapacity : 0;
+            size_t skip = (size_t)std::min<uint64_t>(copy.size(), valid > first ? valid - first : 0);
+            snap.records.assign(copy.begin() + skip, copy.end());
+            snapshots.push_back(std::move(snap));
+        }
+    }
+
+    uint64_t origin = UINT64_MAX;
+    for (const auto& snap : snapshots) {
+        for (const auto& r : snap.records) origin = std::min(origin, r.ns);
+    }
+
+    cJSON* root = cJSON_CreateObject();
+    cJSON* events = cJSON_AddArrayToObject(root, "traceEvents");
+    for (const auto& snap : snapshots) {
+        cJSON* meta = cJSON_CreateObject();
+        cJSON_AddStringToObject(meta, "name", "thread_name");
+        cJSON_AddStringToObject(meta, "ph", "M");
+        cJSON_AddNumberToObject(meta, "pid", 1);
+        cJSON_AddNumberToObject(meta, "tid", snap.tid);
+        cJSON* metaArgs = cJSON_AddObjectToObject(meta, "args");
+        cJSON_AddStringToObject(metaArgs, "name", snap.name.c_str());
+        cJSON_AddItemToArray(events, meta);
+
+        for (const auto& r : snap.records) {
+            cJSON* item = cJSON_CreateObject();
+            cJSON_AddStringToObject(item, "name", eventName(r.event));
+            cJSON_AddStringToObject(item, "ph", "i");
+            cJSON_AddStringToObject(item, "s", "t");
+            cJSON_AddNumberToObject(item, "ts", (r.ns - origin) / 1000.0);
+            cJSON_AddNumberToObject(item, "pid", 1);
+            cJSON_AddNumberToObject(item, "tid", snap.tid);
+            cJSON* args = cJSON_AddObjectToObject(item, "args");
+            if (r.tag[0]) cJSON_AddStringToObject(args, "tag", r.tag);
+            cJSON_AddStringToObject(args, "arg", std::to_string(r.arg).c_str());
+            cJSON_AddItemToArray(events, item);
+        }
+    }
+    cJSON_AddStringToObject(root, "displayTimeUnit", "ns");
+
+    char* text = cJSON_PrintUnformatted(root);
+    std::string json = text ? text : "{}";
+    cJSON_free(text);
+    cJSON_Delete(root);
+    return json;
+}
+
+bool writeChromeTrace(const std::string& path) {
+    std::ofstream file(path);
+    if (!file) return false;
+    file << chromeTraceJson() << "\n";
+    return (bool)file;
+}
+
+} // namespace trace
+} // namespace kuzadesign
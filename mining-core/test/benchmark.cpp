@@ -0,0 +1,558 @@
+// Microbenchmarks for the mining hot paths.
+//
+// Every case runs its body repeatedly for a fixed time; the median of
+// several repetitions is reported as ns/op, together with heap allocations
+// per op (global operator new plus cJSON's allocator).
+//
+// Usage: benchmark [--filter substr] [--quick] [--json results.json]
+//                  [--check baseline.json] [--corpus stratum_corpus.txt]
+//
+// --check compares against a baseline in the --json format (see
+// perf_baseline.json) and exits non-zero on a regression; it is what the
+// perf_gate CTest runs.
+
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include "hash.h"
+#include "miner.h"
+#include "stratum.h"
+#include "topology.h"
+#include "log.h"
+#include "instrument.h"
+#include "protocol.h"
+
+using namespace kuzadesign;
+using Clock = std::chrono::steady_clock;
+
+// --- Allocation counting ---
+
+#ifdef KZD_INSTRUMENTED
+// The library already replaces both allocators; sum its per-subsystem counts
+static uint64_t allocCount() {
+    uint64_t total = 0;
+    for (size_t i = 0; i < (size_t)instrument::Subsystem::Count; i++) {
+        total += instrument::allocationStats((instrument::Subsystem)i).allocations;
+    }
+    return total;
+}
+#else
+static std::atomic<uint64_t> g_allocs{0};
+
+void* operator new(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) return p;
+    throw std::bad_alloc();
+}
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+static void* countingMalloc(size_t size) {
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size);
+}
+
+static uint64_t allocCount() {
+    return g_allocs.load();
+}
+#endif
+
+// Keeps the library's info chatter out of the report while a case runs
+struct QuietLog {
+    logging::Level saved;
+    QuietLog() : saved(logging::level()) { logging::setLevel(logging::Level::Warn); }
+    ~QuietLog() {
+        logging::flush();
+        logging::setLevel(saved);
+    }
+};
+
+// --- Runner ---
+
+struct Result {
+    std::string name;
+    double nsPerOp = 0;
+    double allocsPerOp = 0;
+    uint64_t ops = 0;
+};
+
+static std::vector<Result> g_results;
+static std::string g_filter;
+static int g_minTimeMs = 200;
+static int g_repetitions = 5;
+#ifdef KZD_STRATUM_CORPUS
+static std::string g_corpusPath = KZD_STRATUM_CORPUS;
+#else
+static std::string g_corpusPath = "stratum_corpus.txt";
+#endif
+
+static bool selected(const std::string& name) {
+    return g_filter.empty() || name.find(g_filter) != std::string::npos;
+}
+
+// body() does some work and returns how many ops it did
+static void bench(const std::string& name, const std::function<uint64_t()>& body) {
+    if (!selected(name)) return;
+
+    body();     // Warm caches and lazily initialised state
+
+    std::vector<double> samples;
+    uint64_t totalOps = 0, totalAllocs = 0;
+    for (int rep = 0; rep < g_repetitions; rep++) {
+        uint64_t ops = 0;
+        uint64_t allocs = allocCount();
+        auto start = Clock::now();
+        auto deadline = start + std::chrono::milliseconds(g_minTimeMs);
+        Clock::time_point now;
+        do {
+            ops += body();
+            now = Clock::now();
+        } while (now < deadline);
+        totalAllocs += allocCount() - allocs;
+        totalOps += ops;
+        samples.push_back(std::chrono::duration<double, std::nano>(now - start).count() / ops);
+    }
+    std::sort(samples.begin(), samples.end());
+
+    Result r;
+    r.name = name;
+    r.nsPerOp = samples[samples.size() / 2];
+    r.allocsPerOp = totalOps ? (double)totalAllocs / totalOps : 0;
+    r.ops = totalOps;
+    g_results.push_back(r);
+
+    std::cout << std::left << std::setw(28) << r.name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(14) << r.nsPerOp
+              << std::setprecision(2) << std::setw(14) << r.allocsPerOp << std::endl;
+}
+
+// Single measurement (for cases that are too slow or stateful to repeat)
+static void record(const std::string& name, double nsPerOp, double allocsPerOp, uint64_t ops) {
+    g_results.push_back({ name, nsPerOp, allocsPerOp, ops });
+    std::cout << std::left << std::setw(28) << name << std::right << std::fixed
+              << std::setprecision(1) << std::setw(14) << nsPerOp
+              << std::setprecision(2) << std::setw(14) << allocsPerOp << std::endl;
+}
+
+// --- Fixtures ---
+
+static stratum::Job makeJob(int seq) {
+    stratum::Job job;
+    job.jobId = "bench" + std::to_string(seq);
+    job.header.resize(32);
+    for (size_t i = 0; i < job.header.size(); i++) job.header[i] = (uint8_t)(i * 31 + seq);
+    job.timestamp = 1700000000000ULL + seq;
+    job.cleanJobs = true;
+    job.target.assign(HASH_SIZE, 0);    // Unreachable: no shares
+    job.extraNonce2Size = 4;
+    return job;
+}
+
+// Lines as a pool sends them: notifies with hex and u64-array headers,
+// difficulty changes and submit responses
+static std::string notifyCorpus() {
+    std::ostringstream corpus;
+    for (int i = 0; i < 64; i++) {
+        std::ostringstream hex;
+        for (int b = 0; b < 32; b++) {
+            hex << std::hex << std::setw(2) << std::setfill('0') << ((i * 7 + b * 13) & 0xff);
+        }
+        if (i % 2 == 0) {
+            corpus << "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"" << std::hex << (0x1000 + i)
+                   << std::dec << "\",\"" << hex.str() << "\"," << (1700000000000ULL + i) << "]}\n";
+        } else {
+            corpus << "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"" << std::hex << (0x1000 + i)
+                   << std::dec << "\",[" << (1234567890123ULL * i) << "," << (987654321ULL + i) << ","
+                   << (42ULL * i) << "," << (7ULL + i) << "]," << (1700000000000ULL + i) << "]}\n";
+        }
+        if (i % 16 == 0) {
+            corpus << "{\"id\":null,\"method\":\"mining.set_difficulty\",\"params\":[" << (4 + i) << "]}\n";
+        }
+        if (i % 4 == 0) {
+            corpus << "{\"id\":4,\"result\":true,\"error\":null}\n";
+        }
+    }
+    return corpus.str();
+}
+
+static size_t countLines(const std::string& text) {
+    return (size_t)std::count(text.begin(), text.end(), '\n');
+}
+
+// --- Cases ---
+
+static void hashCases() {
+    uint8_t input[80];
+    uint8_t out[HASH_SIZE];
+    uint8_t target[HASH_SIZE] = {0};
+    for (size_t i = 0; i < sizeof(input); i++) input[i] = (uint8_t)i;
+    uint64_t nonce = 0;
+
+    bench("hash/single", [&]() -> uint64_t {
+        std::memcpy(input + 72, &nonce, 8);
+        nonce++;
+        calculateHash(input, sizeof(input), out);
+        return 1;
+    });
+
+    // Worker-style inner loop: patch nonce, hash, compare against target
+    bench("hash/batch1024", [&]() -> uint64_t {
+        for (int i = 0; i < 1024; i++) {
+            std::memcpy(input + 72, &nonce, 8);
+            nonce++;
+            calculateHash(input, sizeof(input), out);
+            if (checkDifficulty(out, target, HASH_SIZE)) std::abort();
+        }
+        return 1024;
+    });
+
+    std::vector<uint8_t> data(input, input + 72);
+    bench("hash/vector", [&]() -> uint64_t {
+        std::vector<uint8_t> h = calculateHash(data, nonce++);
+        return h.size() == HASH_SIZE ? 1 : 0;
+    });
+
+    uint8_t hash[HASH_SIZE];
+    std::memset(hash, 0xff, sizeof(hash));
+    hash[0] = 0;
+    volatile bool sink = false;
+    bench("checkDifficulty/ptr", [&]() -> uint64_t {
+        for (int i = 0; i < 1024; i++) sink = checkDifficulty(hash, target, HASH_SIZE);
+        return 1024;
+    });
+
+    std::vector<uint8_t> hashVec(hash, hash + HASH_SIZE), targetVec(HASH_SIZE, 0);
+    bench("checkDifficulty/vector", [&]() -> uint64_t {
+        for (int i = 0; i < 1024; i++) sink = checkDifficulty(hashVec, targetVec);
+        return 1024;
+    });
+
+    std::string hex = hashToHex(hashVec);
+    bench("hex/hexToBytes", [&]() -> uint64_t {
+        return hexToBytes(hex).size() == HASH_SIZE ? 1 : 0;
+    });
+    bench("hex/hashToHex", [&]() -> uint64_t {
+        return hashToHex(hashVec).size() == 2 * HASH_SIZE ? 1 : 0;
+    });
+}
+
+static void protocolCases() {
+    const std::string corpus = notifyCorpus();
+    const uint64_t lines = countLines(corpus);
+
+    stratum::Client client;
+    uint64_t jobs = 0;
+    client.onJob([&jobs](const stratum::Job&) { jobs++; });
+
+    QuietLog quiet;
+    bench("client/handleMessage", [&]() -> uint64_t {
+        client.feed(corpus.data(), corpus.size());
+        return lines;
+    });
+
+    // Parse throughput over a recorded pool session (one op = one line)
+    std::ifstream file(g_corpusPath);
+    std::vector<std::string> session;
+    for (std::string line; std::getline(file, line);) {
+        if (!line.empty()) session.push_back(line);
+    }
+    if (session.empty()) {
+        std::cerr << "No corpus at " << g_corpusPath << "; skipping parse cases" << std::endl;
+        return;
+    }
+
+    volatile uint64_t sink = 0;
+    bench("parse/fast", [&]() -> uint64_t {
+        stratum::FastMessage message;
+        for (const std::string& line : session) sink += stratum::parseFastMessage(line, message) ? 1 : 0;
+        return session.size();
+    });
+    bench("parse/cjson", [&]() -> uint64_t {
+        for (const std::string& line : session) {
+            cJSON* json = cJSON_ParseWithLength(line.data(), line.size());
+            sink += json ? 1 : 0;
+            cJSON_Delete(json);
+        }
+        return session.size();
+    });
+
+    std::string sessionText;
+    for (const std::string& line : session) sessionText += line + "\n";
+    bench("client/session", [&]() -> uint64_t {
+        client.feed(sessionText.data(), sessionText.size());
+        return session.size();
+    });
+}
+
+static void minerCases() {
+    if (!selected("miner/setJob") && !selected("miner/jobSwitch") && !selected("miner/hashing")) return;
+    int threads = std::max(2, detectUsableCpus());
+
+    QuietLog quiet;
+    Miner miner;
+    MiningConfig config;
+    config.numThreads = threads;
+    config.intensity = 1.0f;
+    config.hugePages = false;
+    miner.start(config);
+
+    int seq = 0;
+    miner.setJob(makeJob(seq++));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    // Copying a job in while every worker polls jobMutex once per batch
+    std::vector<stratum::Job> jobs;
+    for (int i = 0; i < 16; i++) jobs.push_back(makeJob(1000 + i));
+    bench("miner/setJob", [&]() -> uint64_t {
+        for (const auto& job : jobs) miner.setJob(job);
+        return jobs.size();
+    });
+
+    // End to end: a job is handed over until the slowest worker hashes it
+    if (selected("miner/jobSwitch")) {
+        const int switches = g_minTimeMs >= 200 ? 100 : 25;
+        uint64_t allocs = allocCount();
+        for (int i = 0; i < switches; i++) {
+            stratum::Job job = makeJob(seq++);
+            job.receivedAt = Clock::now();
+            miner.setJob(job);
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        miner.setJob(makeJob(seq++));   // Folds the last switch into the averages
+        double allocsPerSwitch = (double)(allocCount() - allocs) / switches;
+        record("miner/jobSwitch", miner.getStats().notifyLatencyAvgUs * 1000.0, allocsPerSwitch, switches);
+    }
+    miner.stop();
+    if (!selected("miner/hashing")) return;
+
+    // Steady-state hashing on one worker: cost and allocations per hash
+    Miner single;
+    config.numThreads = 1;
+    single.start(config);
+    single.setJob(makeJob(seq++));
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    MiningStats warm = single.getStats();
+    uint64_t hashesBefore = warm.workers.empty() ? 0 : warm.workers[0].hashes;
+    uint64_t allocs = allocCount();
+    auto start = Clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(g_minTimeMs * 2));
+    uint64_t allocsDuring = allocCount() - allocs;
+    MiningStats stats = single.getStats();
+    double elapsedNs = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+    single.stop();
+    uint64_t hashes = stats.workers.empty() ? 0 : stats.workers[0].hashes - hashesBefore;
+    if (hashes > 0) {
+        record("miner/hashing", elapsedNs / hashes, (double)allocsDuring / hashes, hashes);
+    }
+}
+
+// Reference workload independent of our code: ChaCha20 blocks, the same
+// add-rotate-xor shape as the BLAKE3 kernel. Its ns/op tracks how fast this
+// machine is right now (frequency, throttling, noisy neighbours).
+static inline uint32_t rotl(uint32_t v, int n) { return (v << n) | (v >> (32 - n)); }
+
+static void chachaBlock(uint32_t state[16]) {
+    uint32_t x[16];
+    std::memcpy(x, state, sizeof(x));
+    for (int round = 0; round < 10; round++) {
+        for (int c = 0; c < 4; c++) {
+            int a = c, b = 4 + c, d = 12 + c, e = 8 + c;
+            x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+            x[e] += x[d]; x[b] = rotl(x[b] ^ x[e], 12);
+            x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+            x[e] += x[d]; x[b] = rotl(x[b] ^ x[e], 7);
+        }
+        for (int c = 0; c < 4; c++) {
+            int a = c, b = 4 + (c + 1) % 4, e = 8 + (c + 2) % 4, d = 12 + (c + 3) % 4;
+            x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 16);
+            x[e] += x[d]; x[b] = rotl(x[b] ^ x[e], 12);
+            x[a] += x[b]; x[d] = rotl(x[d] ^ x[a], 8);
+            x[e] += x[d]; x[b] = rotl(x[b] ^ x[e], 7);
+        }
+    }
+    for (int i = 0; i < 16; i++) state[i] += x[i];
+}
+
+static void calibrationCase() {
+    uint32_t state[16];
+    for (int i = 0; i < 16; i++) state[i] = 0x61707865u * (i + 1);
+    volatile uint32_t sink = 0;
+    bench("calibration", [&]() -> uint64_t {
+        for (int i = 0; i < 256; i++) chachaBlock(state);
+        sink = state[0];
+        return 256;
+    });
+}
+
+static void runCases() {
+    calibrationCase();
+    hashCases();
+    protocolCases();
+    minerCases();
+}
+
+static const Result* latestResult(const std::string& name) {
+    for (auto it = g_results.rbegin(); it != g_results.rend(); ++it) {
+        if (it->name == name) return &*it;
+    }
+    return nullptr;
+}
+
+// Time may be (1 + tolerance) x the baseline, scaled by how the calibration
+// loop compares with the baseline's, so a throttled or slower machine does
+// not read as a regression. Allocations get a small absolute slack since a
+// case amortises one-off setup over its ops. A case that fails is re-run
+// (up to kRetries times, recalibrating first, best verdict kept) so a noisy
+// neighbour or a frequency dip does not fail the gate on its own.
+static constexpr int kRetries = 2;
+static constexpr double kAllocSlack = 0.05;
+
+static int checkBaseline(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        std::cerr << "Cannot read baseline " << path << std::endl;
+        return 1;
+    }
+    std::stringstream text;
+    text << file.rdbuf();
+    cJSON* root = cJSON_Parse(text.str().c_str());
+    cJSON* entries = root ? cJSON_GetObjectItem(root, "results") : nullptr;
+    if (!cJSON_IsArray(entries)) {
+        std::cerr << "Baseline " << path << " has no results array" << std::endl;
+        cJSON_Delete(root);
+        return 1;
+    }
+    cJSON* defaultTol = cJSON_GetObjectItem(root, "tolerance");
+    double tolerance = cJSON_IsNumber(defaultTol) ? defaultTol->valuedouble : 0.5;
+    if (const char* scale = std::getenv("KZD_PERF_TOLERANCE")) tolerance = std::atof(scale);
+
+    double baselineCalibration = 0;
+    cJSON* entry = nullptr;
+    cJSON_ArrayForEach(entry, entries) {
+        cJSON* name = cJSON_GetObjectItem(entry, "name");
+        cJSON* ns = cJSON_GetObjectItem(entry, "nsPerOp");
+        if (cJSON_IsString(name) && std::string(name->valuestring) == "calibration" && cJSON_IsNumber(ns)) {
+            baselineCalibration = ns->valuedouble;
+        }
+    }
+    auto speedFactor = [&]() {
+        const Result* now = latestResult("calibration");
+        if (!now || baselineCalibration <= 0) return 1.0;
+        return std::min(4.0, std::max(0.25, now->nsPerOp / baselineCalibration));
+    };
+
+    std::cout << std::endl << "Checking against " << path << " (machine speed factor "
+              << std::setprecision(2) << speedFactor() << ")" << std::endl;
+    int failures = 0;
+    cJSON_ArrayForEach(entry, entries) {
+        cJSON* name = cJSON_GetObjectItem(entry, "name");
+        if (!cJSON_IsString(name) || std::string(name->valuestring) == "calibration") continue;
+        cJSON* ns = cJSON_GetObjectItem(entry, "nsPerOp");
+        cJSON* allocs = cJSON_GetObjectItem(entry, "allocsPerOp");
+        cJSON* tol = cJSON_GetObjectItem(entry, "tolerance");
+        double limitTol = cJSON_IsNumber(tol) ? tol->valuedouble : tolerance;
+
+        auto verdict = [&](const Result* r, std::string& why) {
+            why.clear();
+            if (!r) {
+                why = "not measured";
+                return false;
+            }
+            double speed = speedFactor();
+            if (cJSON_IsNumber(ns) && r->nsPerOp > ns->valuedouble * speed * (1.0 + limitTol)) {
+                std::ostringstream msg;
+                msg << std::fixed << std::setprecision(1) << r->nsPerOp << " ns/op > " << ns->valuedouble
+                    << std::setprecision(2) << " x " << speed << " x " << (1.0 + limitTol);
+                why = msg.str();
+            }
+            if (cJSON_IsNumber(allocs) && r->allocsPerOp > allocs->valuedouble * 1.1 + kAllocSlack) {
+                std::ostringstream msg;
+                msg << std::fixed << std::setprecision(2) << (why.empty() ? "" : ", ")
+                    << r->allocsPerOp << " allocs/op > " << allocs->valuedouble;
+                why += msg.str();
+            }
+            return why.empty();
+        };
+
+        std::string why;
+        bool ok = verdict(latestResult(name->valuestring), why);
+        for (int retry = 0; !ok && retry < kRetries; retry++) {
+            std::cout << "  retrying " << name->valuestring << " (" << why << ")" << std::endl;
+            g_filter = "calibration";
+            calibrationCase();
+            g_filter = name->valuestring;
+            runCases();
+            ok = verdict(latestResult(name->valuestring), why);
+        }
+        std::cout << (ok ? "  ok    " : "  FAIL  ") << name->valuestring;
+        if (!ok) std::cout << ": " << why;
+        std::cout << std::endl;
+        if (!ok) failures++;
+    }
+    cJSON_Delete(root);
+
+    if (failures) {
+        std::cout << failures << " performance regression(s)" << std::endl;
+        return 1;
+    }
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
+
+static void writeJson(const std::string& path) {
+    cJSON* root = cJSON_CreateObject();
+    cJSON_AddStringToObject(root, "kernel", hashKernelName());
+    cJSON* results = cJSON_AddArrayToObject(root, "results");
+    for (const auto& r : g_results) {
+        cJSON* item = cJSON_CreateObject();
+        cJSON_AddStringToObject(item, "name", r.name.c_str());
+        cJSON_AddNumberToObject(item, "nsPerOp", r.nsPerOp);
+        cJSON_AddNumberToObject(item, "allocsPerOp", r.allocsPerOp);
+        cJSON_AddNumberToObject(item, "ops", (double)r.ops);
+        cJSON_AddItemToArray(results, item);
+    }
+    char* text = cJSON_Print(root);
+    std::ofstream(path) << text << "\n";
+    cJSON_free(text);
+    cJSON_Delete(root);
+}
+
+int main(int argc, char* argv[]) {
+    std::string jsonPath, baselinePath;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc) g_filter = argv[++i];
+        else if (arg == "--json" && i + 1 < argc) jsonPath = argv[++i];
+        else if (arg == "--check" && i + 1 < argc) baselinePath = argv[++i];
+        else if (arg == "--corpus" && i + 1 < argc) g_corpusPath = argv[++i];
+        else if (arg == "--quick") {
+            g_minTimeMs = 50;
+            g_repetitions = 3;
+        }
+    }
+
+#ifndef KZD_INSTRUMENTED
+    cJSON_Hooks hooks = { countingMalloc, std::free };
+    cJSON_InitHooks(&hooks);
+#endif
+
+    std::cout << "Kernel: " << hashKernelName() << std::endl;
+    std::cout << std::left << std::setw(28) << "benchmark" << std::right
+              << std::setw(14) << "ns/op" << std::setw(14) << "allocs/op" << std::endl;
+
+    runCases();
+
+    if (!jsonPath.empty()) writeJson(jsonPath);
+    return baselinePath.empty() ? 0 : checkBaseline(baselinePath);
+}
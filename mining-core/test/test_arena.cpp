@@ -0,0 +1,75 @@
+#include <cstdint>
+#include <iostream>
+#include "arena.h"
+
+#ifdef __linux__
+    #include <sys/prctl.h>
+#endif
+
+using namespace kuzadesign;
+
+// Huge-page bytes can only be what the backing allows, never assumed
+static bool plausible(const Arena& arena) {
+    size_t huge = arena.hugePageBytes();
+    switch (arena.backing()) {
+        case Arena::Backing::HugeTLB: return huge == arena.capacity();
+        case Arena::Backing::TransparentHuge: return huge <= arena.capacity() && huge % Arena::HUGE_PAGE_SIZE == 0;
+        default: return huge == 0;
+    }
+}
+
+int main() {
+    std::cout << "Testing worker arenas..." << std::endl;
+
+    // Bump allocation honours alignment and capacity
+    Arena plain(4096, false);
+    uint8_t* a = plain.allocateArray<uint8_t>(10);
+    uint8_t* b = static_cast<uint8_t*>(plain.allocate(100, 256));
+    if (!a || !b || reinterpret_cast<uintptr_t>(a) % 64 != 0 || reinterpret_cast<uintptr_t>(b) % 256 != 0 ||
+        plain.allocate(plain.capacity(), 64) != nullptr || plain.backing() != Arena::Backing::Normal ||
+        plain.hugePageBytes() != 0) {
+        std::cerr << "Error: plain arena allocation" << std::endl;
+        return 1;
+    }
+    plain.reset();
+    if (plain.used() != 0 || plain.allocate(plain.capacity(), 64) == nullptr) {
+        std::cerr << "Error: reset did not free the arena" << std::endl;
+        return 1;
+    }
+
+    // Small arenas are never rounded up to a huge page
+    Arena small(4096, true);
+    if (small.capacity() != 4096 || small.backing() != Arena::Backing::Normal) {
+        std::cerr << "Error: 4 KiB arena mapped as " << small.capacity() << " bytes of "
+                  << Arena::backingName(small.backing()) << std::endl;
+        return 1;
+    }
+
+    // A 2 MB arena with huge pages requested: whatever the kernel granted
+    // is reported as measured
+    Arena large(Arena::HUGE_PAGE_SIZE, true);
+    std::cout << "  2 MB arena: " << Arena::backingName(large.backing()) << ", "
+              << large.hugePageBytes() / 1024 << " KiB on huge pages" << std::endl;
+    if (!plausible(large)) {
+        std::cerr << "Error: " << large.hugePageBytes() << " huge-page bytes reported for "
+                  << Arena::backingName(large.backing()) << " backing" << std::endl;
+        return 1;
+    }
+
+#ifdef __linux__
+    // THP disabled for the process: MADV_HUGEPAGE still succeeds, but the
+    // kernel keeps 4 KB pages, and that is what must be reported
+    if (prctl(PR_SET_THP_DISABLE, 1, 0, 0, 0) == 0) {
+        Arena declined(Arena::HUGE_PAGE_SIZE, true);
+        if (declined.backing() == Arena::Backing::TransparentHuge && declined.hugePageBytes() != 0) {
+            std::cerr << "Error: advised-but-declined THP reported as " << declined.hugePageBytes()
+                      << " huge-page bytes" << std::endl;
+            return 1;
+        }
+        prctl(PR_SET_THP_DISABLE, 0, 0, 0, 0);
+    }
+#endif
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
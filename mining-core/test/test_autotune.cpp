@@ -0,0 +1,70 @@
+#include <iostream>
+#include <cmath>
+#include "autotune.h"
+
+using namespace kuzadesign;
+
+// Synthetic machine: throughput peaks at 5 threads, scatter is 10% better
+static double measure(const TuneSetting& s) {
+    double perThread = s.threads <= 5 ? 100.0 : 100.0 - 30.0 * (s.threads - 5);
+    double rate = perThread * s.threads;
+    if (s.placement == PlacementPolicy::Scatter) rate *= 1.1;
+    return rate;
+}
+
+int main() {
+    std::cout << "Testing autotuner convergence..." << std::endl;
+
+    AutoTuner tuner(2, 8, { PlacementPolicy::None, PlacementPolicy::Scatter, PlacementPolicy::Compact });
+
+    TuneSetting current;
+    current.threads = 2;
+    for (int window = 0; window < 60; window++) {
+        TuneSetting next = tuner.next(current, measure(current));
+        if (next.threads < 2 || next.threads > 8) {
+            std::cerr << "Error: tuner left the [2, 8] range: " << next.threads << std::endl;
+            return 1;
+        }
+        current = next;
+    }
+
+    const TuneSetting& best = tuner.best();
+    if (best.threads != 5 || best.placement != PlacementPolicy::Scatter) {
+        std::cerr << "Error: converged on " << best.threads << " threads / "
+                  << placementPolicyName(best.placement) << ", expected 5 / scatter" << std::endl;
+        return 1;
+    }
+
+    // Floor is a hard guard rail even when fewer threads look better
+    AutoTuner floored(4, 8);
+    current.threads = 4;
+    current.placement = PlacementPolicy::None;
+    for (int window = 0; window < 20; window++) {
+        current = floored.next(current, 1000.0 / current.threads);
+        if (current.threads < 4) {
+            std::cerr << "Error: tuner went below its floor" << std::endl;
+            return 1;
+        }
+    }
+
+    // Intensity dimension (efficiency mode): score peaks at 0.6
+    AutoTuner efficient(4, 4);
+    efficient.setIntensityRange(0.3f, 1.0f, 0.1f);
+    current.threads = 4;
+    current.intensity = 1.0f;
+    for (int window = 0; window < 40; window++) {
+        current = efficient.next(current, 100.0 * (1.0 - std::fabs(current.intensity - 0.6)));
+        if (current.intensity < 0.3f - 1e-4f || current.intensity > 1.0f + 1e-4f) {
+            std::cerr << "Error: intensity left its range: " << current.intensity << std::endl;
+            return 1;
+        }
+    }
+    if (std::fabs(efficient.best().intensity - 0.6f) > 0.01f) {
+        std::cerr << "Error: converged on intensity " << efficient.best().intensity
+                  << ", expected 0.6" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
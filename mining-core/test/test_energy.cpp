@@ -0,0 +1,50 @@
+#include <iostream>
+#include <map>
+#include <cmath>
+#include "energy.h"
+
+using namespace kuzadesign;
+
+int main() {
+    std::cout << "Testing RAPL energy meter..." << std::endl;
+
+    // Two packages; package 1 is about to wrap. Subzone 0:0 must be ignored.
+    std::map<std::string, std::string> files = {
+        { "/rapl/intel-rapl:0/energy_uj", "1000000" },
+        { "/rapl/intel-rapl:0/max_energy_range_uj", "262143328850" },
+        { "/rapl/intel-rapl:0:0/energy_uj", "500000" },
+        { "/rapl/intel-rapl:1/energy_uj", "9500000" },
+        { "/rapl/intel-rapl:1/max_energy_range_uj", "10000000" },
+    };
+    auto reader = [&files](const std::string& path, std::string& contents) {
+        auto it = files.find(path);
+        if (it == files.end()) return false;
+        contents = it->second;
+        return true;
+    };
+
+    EnergyMeter meter("/rapl", reader);
+    if (!meter.available() || meter.packageCount() != 2) {
+        std::cerr << "Error: expected 2 packages, found " << meter.packageCount() << std::endl;
+        return 1;
+    }
+
+    // +3 J on package 0, +1 J on package 1 across its wrap (9.5 -> 10 -> 0.5)
+    files["/rapl/intel-rapl:0/energy_uj"] = "4000000";
+    files["/rapl/intel-rapl:1/energy_uj"] = "500000";
+
+    double joules = 0;
+    if (!meter.sample(joules) || std::fabs(joules - 4.0) > 1e-9) {
+        std::cerr << "Error: expected 4 J, got " << joules << std::endl;
+        return 1;
+    }
+
+    EnergyMeter missing("/nonexistent", reader);
+    if (missing.available()) {
+        std::cerr << "Error: meter without counters should be unavailable" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include "stratum.h"
+
+using namespace kuzadesign;
+using Clock = std::chrono::steady_clock;
+
+static void closeSocket(socket_t fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+int main() {
+    std::cout << "Testing Stratum client event loop..." << std::endl;
+
+    // A one-connection "pool" on an ephemeral loopback port
+    socket_t listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    socklen_t addrLen = sizeof(addr);
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 1) != 0 ||
+        getsockname(listenFd, (struct sockaddr*)&addr, &addrLen) != 0) {
+        std::cerr << "Error: could not open a loopback listener" << std::endl;
+        return 1;
+    }
+
+    stratum::Client client;
+    std::atomic<int> jobs{0};
+    std::atomic<int64_t> jobAtNs{0};
+    client.onJob([&](const stratum::Job&) {
+        jobAtNs = Clock::now().time_since_epoch().count();
+        jobs++;
+    });
+    if (!client.connect("127.0.0.1", ntohs(addr.sin_port))) {
+        std::cerr << "Error: client could not connect" << std::endl;
+        return 1;
+    }
+    socket_t pool = accept(listenFd, nullptr, nullptr);
+
+    std::atomic<bool> stopped{false};
+    std::atomic<bool> result{false};
+    std::thread network([&]() {
+        result = client.run();
+        stopped = true;
+    });
+
+    // A notify is handled as soon as it arrives, not on the next poll tick
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    std::string notify = "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"1a\",\""
+                         + std::string(64, '0') + "\",1700000000000]}\n";
+    int64_t sentAtNs = Clock::now().time_since_epoch().count();
+    send(pool, notify.c_str(), (int)notify.size(), 0);
+    for (int i = 0; i < 200 && jobs == 0; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (jobs != 1) {
+        std::cerr << "Error: notify was not handled by run()" << std::endl;
+        return 1;
+    }
+    double handledMs = (jobAtNs - sentAtNs) / 1e6;
+    std::cout << "  notify handled after " << handledMs << " ms" << std::endl;
+    if (handledMs > 50) {
+        std::cerr << "Error: notify took " << handledMs << " ms to handle" << std::endl;
+        return 1;
+    }
+
+    // stop() wakes the loop, which reports a requested stop
+    client.stop();
+    for (int i = 0; i < 200 && !stopped; i++) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    if (!stopped || !result) {
+        std::cerr << "Error: run() did not return after stop()" << std::endl;
+        if (!stopped) closeSocket(pool);
+        network.join();
+        return 1;
+    }
+    network.join();
+
+    // A pool hang-up ends the loop as a lost connection
+    stratum::Client second;
+    second.connect("127.0.0.1", ntohs(addr.sin_port));
+    socket_t pool2 = accept(listenFd, nullptr, nullptr);
+    std::thread hangUp([pool2]() {
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        closeSocket(pool2);
+    });
+    bool lostResult = second.run();
+    hangUp.join();
+    if (lostResult || second.isConnected()) {
+        std::cerr << "Error: run() did not report the lost connection" << std::endl;
+        return 1;
+    }
+
+    closeSocket(pool);
+    closeSocket(listenFd);
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,76 @@
+#include <chrono>
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include "instrument.h"
+
+using namespace kuzadesign;
+
+int main() {
+    std::cout << "Testing lock and allocation instrumentation..." << std::endl;
+
+    // Uncontended acquisitions are counted but never timed
+    InstrumentedMutex mutex(instrument::Lock::Job);
+    for (int i = 0; i < 10; i++) {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+    }
+    instrument::LockStats quiet = instrument::lockStats(instrument::Lock::Job);
+    if (quiet.acquisitions != 10 || quiet.contended != 0 || quiet.wait.count != 0) {
+        std::cerr << "Error: expected 10 uncontended acquisitions, got " << quiet.acquisitions
+                  << " (" << quiet.contended << " contended)" << std::endl;
+        return 1;
+    }
+
+    // A waiter blocked behind a 20 ms hold records one contended wait
+    std::unique_lock<InstrumentedMutex> held(mutex);
+    std::thread waiter([&mutex]() {
+        std::lock_guard<InstrumentedMutex> lock(mutex);
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    held.unlock();
+    waiter.join();
+    instrument::LockStats busy = instrument::lockStats(instrument::Lock::Job);
+    if (busy.acquisitions != 12 || busy.contended != 1 || busy.wait.maxUs < 10000.0) {
+        std::cerr << "Error: contended wait not recorded (" << busy.contended << " contended, max "
+                  << busy.wait.maxUs << " us)" << std::endl;
+        return 1;
+    }
+    if (instrument::lockStats(instrument::Lock::Send).acquisitions != 0) {
+        std::cerr << "Error: lock kinds are not kept apart" << std::endl;
+        return 1;
+    }
+
+    // Allocations land in the scope's subsystem, and only in instrumented builds
+    instrument::AllocationStats before = instrument::allocationStats(instrument::Subsystem::Network);
+    {
+        instrument::AllocationScope scope(instrument::Subsystem::Network);
+        std::unique_ptr<char[]> block(new char[100]);
+        block[0] = 1;
+    }
+    // Over-aligned allocations go through the align_val_t overloads
+    struct alignas(128) Padded {
+        char bytes[256];
+    };
+    {
+        instrument::AllocationScope scope(instrument::Subsystem::Network);
+        std::unique_ptr<Padded> padded(new Padded());
+        if ((reinterpret_cast<uintptr_t>(padded.get()) & 127) != 0) {
+            std::cerr << "Error: over-aligned allocation is misaligned" << std::endl;
+            return 1;
+        }
+    }
+    instrument::AllocationStats after = instrument::allocationStats(instrument::Subsystem::Network);
+    if (instrument::allocationTracking()) {
+        if (after.allocations != before.allocations + 2 || after.bytes != before.bytes + 100 + sizeof(Padded)) {
+            std::cerr << "Error: allocation not charged to the network subsystem" << std::endl;
+            return 1;
+        }
+    } else if (after.allocations != 0) {
+        std::cerr << "Error: allocations counted in an uninstrumented build" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
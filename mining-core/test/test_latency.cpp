@@ -0,0 +1,99 @@
+#include <iostream>
+#include <cmath>
+#include <thread>
+#include <vector>
+#include "latency.h"
+
+using namespace kuzadesign;
+
+// Within the histogram's ~3% bucket resolution
+static bool near(uint64_t actual, uint64_t expected) {
+    return std::fabs((double)actual - (double)expected) <= expected * 0.035 + 1;
+}
+
+int main() {
+    std::cout << "Testing latency histogram..." << std::endl;
+
+    // Every value maps to a bucket whose range contains it
+    for (uint64_t v : {0ull, 1ull, 31ull, 32ull, 63ull, 64ull, 1000ull, 123456789ull}) {
+        size_t bucket = LatencyHistogram::bucketFor(v);
+        uint64_t high = LatencyHistogram::highestEquivalent(bucket);
+        uint64_t low = bucket ? LatencyHistogram::highestEquivalent(bucket - 1) + 1 : 0;
+        if (v < low || v > high) {
+            std::cerr << "Error: " << v << " outside its bucket [" << low << ", " << high << "]" << std::endl;
+            return 1;
+        }
+    }
+    if (LatencyHistogram::bucketFor(~0ull) != LatencyHistogram::kBucketCount - 1) {
+        std::cerr << "Error: huge values should clamp into the last bucket" << std::endl;
+        return 1;
+    }
+
+    LatencyHistogram h;
+    if (h.valueAtPercentile(50) != 0 || h.count() != 0) {
+        std::cerr << "Error: empty histogram should report 0" << std::endl;
+        return 1;
+    }
+
+    // 1..100000 ns, recorded from four threads
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&h, t]() {
+            for (uint64_t v = 1 + t; v <= 100000; v += 4) h.record(v);
+        });
+    }
+    for (auto& thread : threads) thread.join();
+
+    if (h.count() != 100000 || h.max() != 100000) {
+        std::cerr << "Error: count " << h.count() << " max " << h.max() << std::endl;
+        return 1;
+    }
+    if (!near(h.valueAtPercentile(50), 50000) || !near(h.valueAtPercentile(99), 99000) ||
+        !near(h.valueAtPercentile(99.9), 99900) || h.valueAtPercentile(100) != 100000) {
+        std::cerr << "Error: percentiles p50 " << h.valueAtPercentile(50)
+                  << " p99 " << h.valueAtPercentile(99)
+                  << " p999 " << h.valueAtPercentile(99.9) << std::endl;
+        return 1;
+    }
+
+    // A single outlier shows at p999 but not p99
+    LatencyHistogram tail;
+    for (int i = 0; i < 999; i++) tail.record(std::chrono::microseconds(10));
+    tail.record(std::chrono::milliseconds(50));
+    LatencySummary s = summarize(tail);
+    if (s.count != 1000 || !near((uint64_t)(s.p99Us * 1000), 10000) ||
+        !near((uint64_t)(s.p999Us * 1000), 10000) || s.maxUs != 50000.0) {
+        std::cerr << "Error: summary p99 " << s.p99Us << " p999 " << s.p999Us << " max " << s.maxUs << std::endl;
+        return 1;
+    }
+    tail.record(std::chrono::milliseconds(50));
+    if (!near((uint64_t)(summarize(tail).p999Us * 1000), 50000000)) {
+        std::cerr << "Error: p999 should reach the outliers, got " << summarize(tail).p999Us << std::endl;
+        return 1;
+    }
+
+    // Sum of 1..100000; everything up to 1000 ns sits in buckets at or below it
+    if (h.sum() != 5000050000ull || h.countAtOrBelow(1000) < 990 || h.countAtOrBelow(1000) > 1000 ||
+        h.countAtOrBelow(1ull << 40) != 100000) {
+        std::cerr << "Error: sum " << h.sum() << " count <= 1000 " << h.countAtOrBelow(1000) << std::endl;
+        return 1;
+    }
+
+    h.reset();
+    if (h.count() != 0 || h.max() != 0) {
+        std::cerr << "Error: reset should clear the histogram" << std::endl;
+        return 1;
+    }
+
+    // Stage registry
+    latency::resetAll();
+    latency::record(latency::Stage::SubmitToAck, std::chrono::milliseconds(3));
+    if (latency::summary(latency::Stage::SubmitToAck).count != 1 ||
+        latency::summary(latency::Stage::ReadToHandled).count != 0) {
+        std::cerr << "Error: stage histograms should be independent" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
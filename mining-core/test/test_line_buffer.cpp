@@ -0,0 +1,59 @@
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "line_buffer.h"
+
+using namespace kuzadesign::stratum;
+
+// Feeds text in chunks of the given size and collects every line handed out
+static std::vector<std::string> frame(LineBuffer& buffer, const std::string& text, size_t chunk) {
+    std::vector<std::string> lines;
+    for (size_t pos = 0; pos < text.size();) {
+        size_t n = std::min(chunk, std::min(text.size() - pos, buffer.writable()));
+        std::memcpy(buffer.writePtr(), text.data() + pos, n);
+        buffer.commit(n);
+        pos += n;
+        std::string_view line;
+        while (buffer.nextLine(line)) lines.emplace_back(line);
+    }
+    return lines;
+}
+
+int main() {
+    std::cout << "Testing receive line framing..." << std::endl;
+
+    // Lines split across reads at every possible boundary come out whole
+    const std::string text = "{\"id\":1}\n{\"id\":2}\r\n\n{\"id\":3,\"result\":true}\n{\"partial\"";
+    for (size_t chunk = 1; chunk <= text.size(); chunk++) {
+        LineBuffer buffer(32);
+        std::vector<std::string> lines = frame(buffer, text, chunk);
+        if (lines.size() != 4 || lines[0] != "{\"id\":1}" || lines[1] != "{\"id\":2}" || !lines[2].empty() ||
+            lines[3] != "{\"id\":3,\"result\":true}" || buffer.pending() != 10) {
+            std::cerr << "Error: wrong framing with " << chunk << "-byte reads" << std::endl;
+            return 1;
+        }
+    }
+
+    // A line longer than the slab is dropped and framing resumes after it
+    LineBuffer small(16);
+    std::vector<std::string> lines = frame(small, "short\n" + std::string(40, 'x') + "\nnext\n", 7);
+    if (lines.size() != 2 || lines[0] != "short" || lines[1] != "next" || small.overflows() != 1) {
+        std::cerr << "Error: overlong line not skipped (" << lines.size() << " lines, "
+                  << small.overflows() << " overflows)" << std::endl;
+        return 1;
+    }
+
+    // A burst much larger than the slab goes through without losing lines
+    std::string burst;
+    for (int i = 0; i < 1000; i++) burst += "{\"id\":" + std::to_string(i) + "}\n";
+    LineBuffer slab(256);
+    lines = frame(slab, burst, 4096);
+    if (lines.size() != 1000 || lines[999] != "{\"id\":999}" || slab.pending() != 0) {
+        std::cerr << "Error: burst framed into " << lines.size() << " lines" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,77 @@
+#include <iostream>
+#include <thread>
+#include <vector>
+#include "log.h"
+
+using namespace kuzadesign;
+
+int main() {
+    std::cout << "Testing async logger..." << std::endl;
+
+    logging::Level parsed = logging::Level::Info;
+    if (!logging::parseLevel("warn", parsed) || parsed != logging::Level::Warn ||
+        logging::parseLevel("loud", parsed) || std::string(logging::levelName(logging::Level::Debug)) != "debug") {
+        std::cerr << "Error: level names do not round-trip" << std::endl;
+        return 1;
+    }
+
+    // Below the level: nothing is queued or counted
+    logging::setLevel(logging::Level::Warn);
+    logging::info("hidden %d", 1);
+    logging::debug("hidden %d", 2);
+    logging::flush();
+    logging::Counters before = logging::counters();
+    if (before.written != 0 || before.suppressed != 0 || logging::enabled(logging::Level::Info)) {
+        std::cerr << "Error: messages below the level were written" << std::endl;
+        return 1;
+    }
+
+    // Rate limit: a burst of 20 within (at most) two one-second windows of 5
+    logging::setLevel(logging::Level::Info);
+    logging::setRateLimit(5);
+    for (int i = 0; i < 20; i++) logging::info("rate limited line %d", i);
+    logging::error("errors are never rate limited");
+    logging::flush();
+    logging::Counters limited = logging::counters();
+    if (limited.suppressed < 10 || limited.written < 6) {
+        std::cerr << "Error: rate limit suppressed " << limited.suppressed << ", wrote " << limited.written << std::endl;
+        return 1;
+    }
+
+    // Status lines are never rate limited, and still written above their level
+    logging::setRateLimit(1);
+    for (int i = 0; i < 20; i++) logging::info("rate limited again %d", i);
+    for (int i = 0; i < 10; i++) logging::status("[STATS]|%d|0", i);
+    logging::setLevel(logging::Level::Warn);
+    for (int i = 0; i < 3; i++) logging::status("Connected to pool %d", i);
+    logging::flush();
+    logging::setLevel(logging::Level::Info);
+    logging::Counters status = logging::counters();
+    uint64_t statusWritten = status.written - limited.written;
+    if (statusWritten < 13 || statusWritten > 15 || status.suppressed - limited.suppressed < 18) {
+        std::cerr << "Error: status lines were limited (" << statusWritten << " written)" << std::endl;
+        return 1;
+    }
+    limited = status;
+
+    // Concurrent producers: every line is either written or counted as dropped
+    logging::setRateLimit(0);
+    const int threads = 4, perThread = 500;
+    std::vector<std::thread> producers;
+    for (int t = 0; t < threads; t++) {
+        producers.emplace_back([t]() {
+            for (int i = 0; i < perThread; i++) logging::info("producer %d line %d", t, i);
+        });
+    }
+    for (auto& producer : producers) producer.join();
+    logging::flush();
+    logging::Counters after = logging::counters();
+    uint64_t accounted = (after.written - limited.written) + (after.dropped - limited.dropped);
+    if (accounted != (uint64_t)(threads * perThread)) {
+        std::cerr << "Error: " << accounted << " of " << threads * perThread << " lines accounted for" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
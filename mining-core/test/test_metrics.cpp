@@ -0,0 +1,108 @@
+#include <iostream>
+#include <cstring>
+#include <string>
+#include "metrics.h"
+#include "latency.h"
+
+using namespace kuzadesign;
+
+static bool contains(const std::string& text, const std::string& needle) {
+    if (text.find(needle) != std::string::npos) return true;
+    std::cerr << "Error: missing \"" << needle << "\"" << std::endl;
+    return false;
+}
+
+// Plain HTTP GET against 127.0.0.1:port, returning the whole response
+static std::string httpGet(int port, const std::string& path) {
+    socket_t fd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((uint16_t)port);
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    std::string response;
+    if (connect(fd, (struct sockaddr*)&addr, sizeof(addr)) == 0) {
+        std::string request = "GET " + path + " HTTP/1.0\r\nHost: localhost\r\n\r\n";
+        send(fd, request.c_str(), (int)request.size(), 0);
+        char buffer[4096];
+        ssize_t_compat n;
+        while ((n = recv(fd, buffer, sizeof(buffer), 0)) > 0) response.append(buffer, (size_t)n);
+    }
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+    return response;
+}
+
+int main() {
+    std::cout << "Testing OpenMetrics exposition..." << std::endl;
+
+    MiningStats stats;
+    stats.hashrate10s = 1500.5;
+    stats.sharesAccepted = 3;
+    WorkerStats worker;
+    worker.threadId = 7;
+    worker.hashes = 123456789;
+    stats.workers.push_back(worker);
+
+    MetricsInfo info;
+    info.connected = true;
+    info.shares.submitted = 3;
+    info.shares.accepted = 2;
+    info.shares.stale = 1;
+
+    latency::resetAll();
+    latency::record(latency::Stage::SubmitToAck, std::chrono::microseconds(30));
+    latency::record(latency::Stage::SubmitToAck, std::chrono::milliseconds(2));
+
+    std::string text = renderOpenMetrics(stats, info);
+    if (!contains(text, "kzd_build_info{kernel=\"") ||
+        !contains(text, "kzd_pool_connected 1\n") ||
+        !contains(text, "kzd_hashrate_hashes_per_second{window=\"10s\"} 1500.5\n") ||
+        !contains(text, "kzd_shares_total{result=\"accepted\"} 2\n") ||
+        !contains(text, "kzd_shares_total{result=\"stale\"} 1\n") ||
+        !contains(text, "kzd_worker_hashes_total{worker=\"7\"} 123456789\n") ||
+        !contains(text, "kzd_stage_latency_seconds_bucket{stage=\"submitToAck\",le=\"1e-05\"} 0\n") ||
+        !contains(text, "kzd_stage_latency_seconds_bucket{stage=\"submitToAck\",le=\"5e-05\"} 1\n") ||
+        !contains(text, "kzd_stage_latency_seconds_bucket{stage=\"submitToAck\",le=\"+Inf\"} 2\n") ||
+        !contains(text, "kzd_stage_latency_seconds_count{stage=\"submitToAck\"} 2\n")) {
+        return 1;
+    }
+    if (text.size() < 6 || text.compare(text.size() - 6, 6, "# EOF\n") != 0) {
+        std::cerr << "Error: exposition must end with # EOF" << std::endl;
+        return 1;
+    }
+    if (text.find("kzd_worker_cycles") != std::string::npos) {
+        std::cerr << "Error: cycle counters without cycle accounting" << std::endl;
+        return 1;
+    }
+
+    // Served over HTTP on an ephemeral port; the provider result is cached
+    int calls = 0;
+    MetricsServer server;
+    if (!server.start("127.0.0.1", 0, [&]() { calls++; return text; }, 60000)) {
+        std::cerr << "Error: could not start metrics server" << std::endl;
+        return 1;
+    }
+    std::string first = httpGet(server.port(), "/metrics");
+    std::string second = httpGet(server.port(), "/metrics");
+    std::string missing = httpGet(server.port(), "/other");
+    server.stop();
+
+    if (!contains(first, "HTTP/1.0 200 OK\r\n") || !contains(first, "application/openmetrics-text") ||
+        !contains(first, "\r\n\r\n" + text) || second != first) {
+        return 1;
+    }
+    if (calls != 1) {
+        std::cerr << "Error: provider called " << calls << " times, expected 1" << std::endl;
+        return 1;
+    }
+    if (!contains(missing, "404 Not Found")) {
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,73 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <cmath>
+#include "monitor.h"
+
+namespace fs = std::filesystem;
+using namespace kuzadesign;
+
+static void writeFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content << "\n";
+}
+
+int main() {
+    std::cout << "Testing system monitor..." << std::endl;
+
+    fs::path root = fs::temp_directory_path() / "kzd_test_monitor";
+    fs::remove_all(root);
+    fs::path proc = root / "proc";
+    fs::path sys = root / "sys";
+
+    // Zone 0 is not the CPU; zone 1 is the package sensor
+    writeFile(sys / "class/thermal/thermal_zone0/type", "acpitz");
+    writeFile(sys / "class/thermal/thermal_zone0/temp", "30000");
+    writeFile(sys / "class/thermal/thermal_zone1/type", "x86_pkg_temp");
+    writeFile(sys / "class/thermal/thermal_zone1/temp", "71500");
+
+    SystemMonitor monitor(proc.string(), sys.string());
+
+    writeFile(proc / "stat", "cpu  100 0 100 800 0 0 0 0 0 0");
+    if (!monitor.sample()) {
+        std::cerr << "Error: first sample failed" << std::endl;
+        return 1;
+    }
+
+    // +300 busy (40 of it stolen), +100 idle => 75% busy, 10% steal
+    writeFile(proc / "stat", "cpu  260 0 200 900 0 0 0 40 0 0");
+    monitor.sample();
+
+    if (std::fabs(monitor.cpuUsage() - 75.0f) > 0.01f) {
+        std::cerr << "Error: cpuUsage " << monitor.cpuUsage() << ", expected 75" << std::endl;
+        return 1;
+    }
+    if (std::fabs(monitor.stealPercent() - 10.0f) > 0.01f) {
+        std::cerr << "Error: steal " << monitor.stealPercent() << ", expected 10" << std::endl;
+        return 1;
+    }
+    if (std::fabs(monitor.cpuTemp() - 71.5f) > 0.01f) {
+        std::cerr << "Error: cpuTemp " << monitor.cpuTemp() << ", expected 71.5" << std::endl;
+        return 1;
+    }
+
+    if (monitor.cpuPressure() != -1.0f) {
+        std::cerr << "Error: pressure without PSI should be -1" << std::endl;
+        return 1;
+    }
+
+    writeFile(proc / "pressure/cpu", "some avg10=12.50 avg60=3.00 avg300=1.00 total=123456\n"
+                                     "full avg10=0.00 avg60=0.00 avg300=0.00 total=0");
+    writeFile(proc / "loadavg", "2.75 1.50 1.00 3/456 7890");
+    writeFile(proc / "stat", "cpu  360 0 300 1000 0 0 0 40 0 0");
+    monitor.sample();
+    if (std::fabs(monitor.cpuPressure() - 12.5f) > 0.01f || std::fabs(monitor.loadAverage() - 2.75f) > 0.01f) {
+        std::cerr << "Error: pressure " << monitor.cpuPressure() << " / load " << monitor.loadAverage()
+                  << ", expected 12.5 / 2.75" << std::endl;
+        return 1;
+    }
+
+    fs::remove_all(root);
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
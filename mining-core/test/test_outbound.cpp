@@ -0,0 +1,131 @@
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "stratum.h"
+
+using namespace kuzadesign;
+
+static void closeSocket(socket_t fd) {
+#ifdef _WIN32
+    closesocket(fd);
+#else
+    close(fd);
+#endif
+}
+
+// Reads from the pool side until `lines` newline-terminated lines arrived
+// (or the deadline passes)
+static std::vector<std::string> readLines(socket_t fd, size_t lines, int timeoutMs) {
+    std::vector<std::string> out;
+    std::string pending;
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+    char buffer[65536];
+    while (out.size() < lines && std::chrono::steady_clock::now() < deadline) {
+        fd_set readable;
+        FD_ZERO(&readable);
+        FD_SET(fd, &readable);
+        struct timeval tick = { 0, 20000 };
+        if (select((int)fd + 1, &readable, nullptr, nullptr, &tick) <= 0) continue;
+        ssize_t_compat n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n <= 0) break;
+        pending.append(buffer, (size_t)n);
+        size_t pos;
+        while ((pos = pending.find('\n')) != std::string::npos) {
+            out.push_back(pending.substr(0, pos));
+            pending.erase(0, pos + 1);
+        }
+    }
+    return out;
+}
+
+int main() {
+    std::cout << "Testing Stratum outbound queue..." << std::endl;
+
+    socket_t listenFd = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = 0;
+    addr.sin_addr.s_addr = inet_addr("127.0.0.1");
+    socklen_t addrLen = sizeof(addr);
+    // A small receive window so the client's socket buffer fills quickly
+    int window = 4096;
+    setsockopt(listenFd, SOL_SOCKET, SO_RCVBUF, (const char*)&window, sizeof(window));
+    if (bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 1) != 0 ||
+        getsockname(listenFd, (struct sockaddr*)&addr, &addrLen) != 0) {
+        std::cerr << "Error: could not open a loopback listener" << std::endl;
+        return 1;
+    }
+
+    stratum::Client client;
+    if (!client.connect("127.0.0.1", ntohs(addr.sin_port))) {
+        std::cerr << "Error: client could not connect" << std::endl;
+        return 1;
+    }
+    socket_t pool = accept(listenFd, nullptr, nullptr);
+    std::thread network([&client]() { client.run(); });
+
+    // Submits are rendered from the template exactly as cJSON printed them
+    client.submit("1a\"b", 0, 0x1234abcdULL, 0);
+    std::vector<std::string> first = readLines(pool, 1, 1000);
+    const std::string expected =
+        "{\"id\":4,\"method\":\"mining.submit\",\"params\":[\"generic\",\"1a\\\"b\",\"000000001234abcd\"]}";
+    if (first.size() != 1 || first[0] != expected) {
+        std::cerr << "Error: submit rendered as " << (first.empty() ? "<nothing>" : first[0]) << std::endl;
+        return 1;
+    }
+
+    // Concurrent submitters: every share arrives whole and parseable
+    const int threads = 4, perThread = 10;
+    std::vector<std::thread> submitters;
+    for (int t = 0; t < threads; t++) {
+        submitters.emplace_back([&client, t]() {
+            for (int i = 0; i < perThread; i++) client.submit("job" + std::to_string(t), 0, (uint64_t)i, 0);
+        });
+    }
+    for (auto& submitter : submitters) submitter.join();
+    std::vector<std::string> concurrent = readLines(pool, threads * perThread, 2000);
+    for (const std::string& line : concurrent) {
+        cJSON* json = cJSON_Parse(line.c_str());
+        bool ok = json && cJSON_GetArraySize(cJSON_GetObjectItem(json, "params")) == 3;
+        cJSON_Delete(json);
+        if (!ok) {
+            std::cerr << "Error: interleaved or broken line: " << line << std::endl;
+            return 1;
+        }
+    }
+    if (concurrent.size() != (size_t)(threads * perThread)) {
+        std::cerr << "Error: " << concurrent.size() << " of " << threads * perThread << " shares arrived" << std::endl;
+        return 1;
+    }
+
+    // With the pool not reading, the socket fills and the queue takes the
+    // rest; once the pool reads again, run() flushes it on writability
+    size_t accepted = 0;
+    for (int i = 0; i < 200000; i++) {
+        if (!client.submit("backlog", 0, (uint64_t)i, 0)) break;
+        accepted++;
+    }
+    if (accepted == 200000) {
+        std::cerr << "Error: outbound queue never filled" << std::endl;
+        return 1;
+    }
+    std::vector<std::string> backlog = readLines(pool, accepted, 10000);
+    if (backlog.size() != accepted) {
+        std::cerr << "Error: " << backlog.size() << " of " << accepted << " queued shares flushed" << std::endl;
+        return 1;
+    }
+    std::cout << "  " << accepted << " shares sent through a full socket" << std::endl;
+
+    client.stop();
+    network.join();
+    client.disconnect();
+    closeSocket(pool);
+    closeSocket(listenFd);
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,103 @@
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "protocol.h"
+#include "stratum.h"
+
+using namespace kuzadesign;
+using namespace kuzadesign::stratum;
+
+// What the cJSON path extracts from a line, for comparison
+static bool matchesCJson(const std::string& line, const FastMessage& fast) {
+    cJSON* json = cJSON_Parse(line.c_str());
+    if (!json) return false;
+    bool ok = false;
+    cJSON* method = cJSON_GetObjectItem(json, "method");
+    cJSON* params = cJSON_GetObjectItem(json, "params");
+    if (fast.kind == FastMessage::Kind::Notify && cJSON_IsString(method) &&
+        std::string(method->valuestring) == "mining.notify") {
+        cJSON* header = cJSON_GetArrayItem(params, 1);
+        uint8_t expected[32] = {};
+        if (cJSON_IsString(header)) {
+            std::vector<uint8_t> bytes = hexToBytes(header->valuestring);
+            std::memcpy(expected, bytes.data(), bytes.size() < 32 ? bytes.size() : 32);
+        } else {
+            for (int i = 0; i < 4; i++) {
+                uint64_t word = (uint64_t)cJSON_GetArrayItem(header, i)->valuedouble;
+                std::memcpy(expected + i * 8, &word, 8);
+            }
+        }
+        ok = fast.jobId == cJSON_GetArrayItem(params, 0)->valuestring &&
+             std::memcmp(expected, fast.header, 32) == 0 &&
+             fast.timestamp == (uint64_t)cJSON_GetArrayItem(params, 2)->valuedouble;
+    } else if (fast.kind == FastMessage::Kind::SetDifficulty) {
+        ok = fast.difficulty == cJSON_GetArrayItem(params, 0)->valuedouble;
+    } else if (fast.kind == FastMessage::Kind::Response) {
+        cJSON* id = cJSON_GetObjectItem(json, "id");
+        cJSON* error = cJSON_GetObjectItem(json, "error");
+        cJSON* code = cJSON_IsArray(error) ? cJSON_GetArrayItem(error, 0) : cJSON_GetObjectItem(error, "code");
+        cJSON* text = cJSON_IsArray(error) ? cJSON_GetArrayItem(error, 1) : cJSON_GetObjectItem(error, "message");
+        bool stale = (cJSON_IsNumber(code) && code->valueint == 21) ||
+                     (cJSON_IsString(text) && mentionsStale(text->valuestring));
+        ok = fast.id == (cJSON_IsNumber(id) ? (uint64_t)id->valuedouble : 0) &&
+             fast.accepted == (bool)cJSON_IsTrue(cJSON_GetObjectItem(json, "result")) && fast.stale == stale;
+    }
+    cJSON_Delete(json);
+    return ok;
+}
+
+int main(int argc, char* argv[]) {
+    std::cout << "Testing fast Stratum parser..." << std::endl;
+
+    // Every line the fast path accepts must decode exactly as cJSON does
+    std::ifstream file(argc > 1 ? argv[1] : "stratum_corpus.txt");
+    int lines = 0, fastLines = 0;
+    for (std::string line; std::getline(file, line);) {
+        if (line.empty()) continue;
+        lines++;
+        FastMessage fast;
+        if (!parseFastMessage(line, fast)) continue;
+        fastLines++;
+        if (!matchesCJson(line, fast)) {
+            std::cerr << "Error: fast parse differs from cJSON for: " << line << std::endl;
+            return 1;
+        }
+    }
+    std::cout << "  " << fastLines << " of " << lines << " corpus lines on the fast path" << std::endl;
+    if (lines == 0 || fastLines < lines * 9 / 10) {
+        std::cerr << "Error: too few corpus lines took the fast path" << std::endl;
+        return 1;
+    }
+
+    // Shapes that must be left to cJSON
+    const char* fallbacks[] = {
+        "{\"id\":1,\"result\":[[\"mining.notify\",\"1\"],\"0a\",4],\"error\":null}",
+        "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"a\\\"b\",\"00\",1]}",
+        "{\"id\":null,\"method\":\"mining.notify\",\"params\":[\"1\",\"abcd\",1]}",
+        "{\"id\":null,\"method\":\"client.reconnect\",\"params\":[]}",
+        "{\"id\":1.5,\"result\":true}",
+        "{\"id\":1,\"result\":true} trailing",
+        "{\"id\":1,\"result\":true",
+        "",
+    };
+    for (const char* line : fallbacks) {
+        FastMessage fast;
+        if (parseFastMessage(line, fast)) {
+            std::cerr << "Error: fast path accepted: " << line << std::endl;
+            return 1;
+        }
+    }
+
+    // Key order and extra keys do not matter; stale errors are recognised
+    FastMessage ack;
+    if (!parseFastMessage(" {\"jsonrpc\":\"2.0\", \"error\": {\"code\": 21, \"message\": \"Stale\"}, \"result\": false, \"id\": 42 } ", ack) ||
+        ack.kind != FastMessage::Kind::Response || ack.id != 42 || ack.accepted || !ack.stale) {
+        std::cerr << "Error: reordered stale response not parsed" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+#include "topology.h"
+
+namespace fs = std::filesystem;
+using namespace kuzadesign;
+
+static void writeFile(const fs::path& path, const std::string& content) {
+    fs::create_directories(path.parent_path());
+    std::ofstream(path) << content << "\n";
+}
+
+// Dual socket, 2 cores per socket, 2 SMT threads per core.
+// Linux numbering: cpu0-3 are the first threads, cpu4-7 their siblings.
+static fs::path makeFakeSysfs() {
+    fs::path root = fs::temp_directory_path() / "kzd_test_topology";
+    fs::remove_all(root);
+
+    writeFile(root / "cpu/online", "0-7");
+    for (int cpu = 0; cpu < 8; cpu++) {
+        int first = cpu % 4;
+        fs::path topo = root / ("cpu/cpu" + std::to_string(cpu)) / "topology";
+        writeFile(topo / "core_id", std::to_string(first % 2));
+        writeFile(topo / "physical_package_id", std::to_string(first / 2));
+    }
+    writeFile(root / "node/online", "0-1");
+    writeFile(root / "node/node0/cpulist", "0-1,4-5");
+    writeFile(root / "node/node1/cpulist", "2-3,6-7");
+    return root;
+}
+
+static bool expect(const char* name, const std::vector<int>& got, const std::vector<int>& want) {
+    if (got == want) return true;
+    std::cerr << "Error: " << name << " placement was";
+    for (int cpu : got) std::cerr << " " << cpu;
+    std::cerr << ", expected";
+    for (int cpu : want) std::cerr << " " << cpu;
+    std::cerr << std::endl;
+    return false;
+}
+
+int main() {
+    std::cout << "Testing CPU topology and cgroup quota discovery..." << std::endl;
+
+    if (parseCpuList("0-2,5,7-8") != std::vector<int>{0, 1, 2, 5, 7, 8}) {
+        std::cerr << "Error: parseCpuList" << std::endl;
+        return 1;
+    }
+
+    fs::path root = makeFakeSysfs();
+    CpuTopology topo = CpuTopology::discover(root.string(), {});
+
+    if (topo.cpus().size() != 8 || topo.nodeCount() != 2 || topo.coreCount() != 4) {
+        std::cerr << "Error: expected 8 cpus / 4 cores / 2 nodes" << std::endl;
+        return 1;
+    }
+    if (topo.nodeOf(6) != 1) {
+        std::cerr << "Error: cpu6 should be on node 1" << std::endl;
+        return 1;
+    }
+
+    bool ok = true;
+    ok &= expect("compact", topo.placement(PlacementPolicy::Compact), {0, 4, 1, 5, 2, 6, 3, 7});
+    ok &= expect("scatter", topo.placement(PlacementPolicy::Scatter), {0, 2, 1, 3, 4, 6, 5, 7});
+    ok &= expect("physical", topo.placement(PlacementPolicy::PhysicalCores), {0, 1, 2, 3});
+    ok &= expect("node1", topo.placement(PlacementPolicy::NodeLocal, 1), {2, 3, 6, 7});
+    ok &= expect("none", topo.placement(PlacementPolicy::None), {});
+
+    // taskset -c 1-4,6: cpu0 and its node-0 core mate cpu4 lose their first
+    // thread, so cpu4 becomes that core's sibling 0; nothing outside the
+    // mask may be placed
+    CpuTopology restricted = CpuTopology::discover(root.string(), {1, 2, 3, 4, 6});
+    if (restricted.cpus().size() != 5 || restricted.coreCount() != 4 || restricted.nodeOf(0) != -1) {
+        std::cerr << "Error: affinity mask not applied to discovered CPUs" << std::endl;
+        return 1;
+    }
+    ok &= expect("masked compact", restricted.placement(PlacementPolicy::Compact), {4, 1, 2, 6, 3});
+    ok &= expect("masked scatter", restricted.placement(PlacementPolicy::Scatter), {4, 2, 1, 3, 6});
+    ok &= expect("masked physical", restricted.placement(PlacementPolicy::PhysicalCores), {4, 1, 2, 3});
+    ok &= expect("masked node0", restricted.placement(PlacementPolicy::NodeLocal, 0), {4, 1});
+
+    // A mask sysfs knows nothing about is used as a flat topology
+    CpuTopology foreign = CpuTopology::discover(root.string(), {12, 13});
+    ok &= expect("foreign mask", foreign.placement(PlacementPolicy::Compact), {12, 13});
+
+    fs::remove_all(root);
+    if (!ok) return 1;
+
+    // cgroup v2: our group allows 3 CPUs but its parent only 2.5
+    fs::path cg = fs::temp_directory_path() / "kzd_test_cgroup";
+    fs::remove_all(cg);
+    writeFile(cg / "self_cgroup", "0::/kubepods/pod1");
+    writeFile(cg / "fs/cpu.max", "max 100000");
+    writeFile(cg / "fs/kubepods/cpu.max", "250000 100000");
+    writeFile(cg / "fs/kubepods/pod1/cpu.max", "300000 100000");
+    double quota = cgroupCpuQuota((cg / "fs").string(), (cg / "self_cgroup").string());
+    if (quota < 2.49 || quota > 2.51) {
+        std::cerr << "Error: v2 quota " << quota << ", expected 2.5" << std::endl;
+        return 1;
+    }
+
+    // cgroup v1: 1.5 CPUs on the cpu,cpuacct hierarchy; unlimited is -1
+    writeFile(cg / "self_cgroup_v1", "4:cpu,cpuacct:/docker/abc\n3:memory:/docker/abc");
+    writeFile(cg / "v1/cpu,cpuacct/docker/abc/cpu.cfs_quota_us", "150000");
+    writeFile(cg / "v1/cpu,cpuacct/docker/abc/cpu.cfs_period_us", "100000");
+    quota = cgroupCpuQuota((cg / "v1").string(), (cg / "self_cgroup_v1").string());
+    if (quota < 1.49 || quota > 1.51) {
+        std::cerr << "Error: v1 quota " << quota << ", expected 1.5" << std::endl;
+        return 1;
+    }
+    writeFile(cg / "v1/cpu,cpuacct/docker/abc/cpu.cfs_quota_us", "-1");
+    if (cgroupCpuQuota((cg / "v1").string(), (cg / "self_cgroup_v1").string()) != -1) {
+        std::cerr << "Error: unlimited v1 quota should be -1" << std::endl;
+        return 1;
+    }
+    fs::remove_all(cg);
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}
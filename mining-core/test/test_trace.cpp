@@ -0,0 +1,173 @@
+#include <atomic>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "trace.h"
+
+extern "C" {
+#include "cJSON.h"
+}
+
+using namespace kuzadesign;
+
+// Instant events of one dump, grouped by thread id, plus the thread names
+struct Dump {
+    std::map<int, std::vector<std::pair<std::string, uint64_t>>> events;   // tid -> (tag, arg)
+    std::map<int, std::string> names;
+    bool wellFormed = true;
+};
+
+static Dump parseDump(const std::string& json) {
+    Dump dump;
+    cJSON* root = cJSON_Parse(json.c_str());
+    cJSON* events = cJSON_GetObjectItem(root, "traceEvents");
+    if (!cJSON_IsArray(events)) {
+        dump.wellFormed = false;
+        cJSON_Delete(root);
+        return dump;
+    }
+    cJSON* item;
+    cJSON_ArrayForEach(item, events) {
+        cJSON* ph = cJSON_GetObjectItem(item, "ph");
+        cJSON* tid = cJSON_GetObjectItem(item, "tid");
+        cJSON* name = cJSON_GetObjectItem(item, "name");
+        cJSON* args = cJSON_GetObjectItem(item, "args");
+        if (!cJSON_IsString(ph) || !cJSON_IsNumber(tid) || !cJSON_IsString(name) || !cJSON_IsObject(args)) {
+            dump.wellFormed = false;
+            continue;
+        }
+        if (std::strcmp(ph->valuestring, "M") == 0) {
+            cJSON* threadName = cJSON_GetObjectItem(args, "name");
+            if (std::strcmp(name->valuestring, "thread_name") != 0 || !cJSON_IsString(threadName)) {
+                dump.wellFormed = false;
+                continue;
+            }
+            dump.names[tid->valueint] = threadName->valuestring;
+        } else if (std::strcmp(ph->valuestring, "i") == 0) {
+            cJSON* ts = cJSON_GetObjectItem(item, "ts");
+            cJSON* tag = cJSON_GetObjectItem(args, "tag");
+            cJSON* arg = cJSON_GetObjectItem(args, "arg");
+            if (!cJSON_IsNumber(ts) || ts->valuedouble < 0 || !cJSON_IsString(arg)) {
+                dump.wellFormed = false;
+                continue;
+            }
+            dump.events[tid->valueint].emplace_back(cJSON_IsString(tag) ? tag->valuestring : "",
+                                                    std::stoull(arg->valuestring));
+        } else {
+            dump.wellFormed = false;
+        }
+    }
+    cJSON_Delete(root);
+    return dump;
+}
+
+// Args recorded under `tag` by the thread named `name`
+static std::vector<uint64_t> argsOf(const Dump& dump, const std::string& name, const std::string& tag) {
+    std::vector<uint64_t> args;
+    for (const auto& entry : dump.names) {
+        if (entry.second != name) continue;
+        auto it = dump.events.find(entry.first);
+        if (it == dump.events.end()) continue;
+        for (const auto& event : it->second) {
+            if (event.first == tag) args.push_back(event.second);
+        }
+    }
+    return args;
+}
+
+static bool consecutive(const std::vector<uint64_t>& args) {
+    for (size_t i = 1; i < args.size(); i++) {
+        if (args[i] != args[i - 1] + 1) return false;
+    }
+    return true;
+}
+
+int main() {
+    std::cout << "Testing event trace rings..." << std::endl;
+    trace::setThreadName("main");
+
+    // Chrome trace shape: traceEvents with thread_name metadata and
+    // instant events carrying ph, ts, pid, tid and args
+    trace::record(trace::Event::JobPublished, "shape", 7);
+    std::string json = trace::chromeTraceJson();
+    Dump dump = parseDump(json);
+    if (!dump.wellFormed || argsOf(dump, "main", "shape") != std::vector<uint64_t>{7} ||
+        json.find("\"name\":\"job published\"") == std::string::npos ||
+        json.find("\"displayTimeUnit\":\"ns\"") == std::string::npos) {
+        std::cerr << "Error: unexpected Chrome trace output: " << json.substr(0, 200) << std::endl;
+        return 1;
+    }
+
+    // Disabled tracing records nothing
+    trace::setEnabled(false);
+    trace::record(trace::Event::JobPublished, "disabled", 1);
+    trace::setEnabled(true);
+    if (!argsOf(parseDump(trace::chromeTraceJson()), "main", "disabled").empty()) {
+        std::cerr << "Error: event recorded while tracing was disabled" << std::endl;
+        return 1;
+    }
+
+    // Past 4096 events the ring wraps: the newest survive, in order. The
+    // slot the writer would fill next is never trusted, so that is 4095.
+    for (uint64_t i = 0; i < 5000; i++) trace::record(trace::Event::CandidateFound, "wrap", i);
+    std::vector<uint64_t> wrapped = argsOf(parseDump(trace::chromeTraceJson()), "main", "wrap");
+    if (wrapped.size() != 4095 || wrapped.front() != 5000 - 4095 || wrapped.back() != 4999 || !consecutive(wrapped)) {
+        std::cerr << "Error: wrapped ring kept " << wrapped.size() << " events" << std::endl;
+        return 1;
+    }
+
+    // A writer lapping the ring while it is dumped: slots overwritten during
+    // the copy are discarded, so what is left is always one unbroken run
+    std::atomic<bool> writing{true};
+    std::thread writer([&writing]() {
+        trace::setThreadName("writer");
+        for (uint64_t i = 0; writing; i++) trace::record(trace::Event::SubmitQueued, "lap", i);
+    });
+    for (int round = 0; round < 20; round++) {
+        Dump live = parseDump(trace::chromeTraceJson());
+        std::vector<uint64_t> args = argsOf(live, "writer", "lap");
+        if (!live.wellFormed || args.size() > 4095 || !consecutive(args)) {
+            std::cerr << "Error: dump during writes returned " << args.size() << " events, not one run" << std::endl;
+            writing = false;
+            writer.join();
+            return 1;
+        }
+    }
+    writing = false;
+    writer.join();
+
+    // Rings of exited threads are reused once 256 exist; a reused ring
+    // starts empty and takes the new thread's name
+    const int threads = 300;
+    for (int i = 0; i < threads; i++) {
+        std::thread t([i]() {
+            trace::setThreadName("short " + std::to_string(i));
+            trace::record(trace::Event::JobPickedUp, "reuse", (uint64_t)i);
+        });
+        t.join();
+    }
+    dump = parseDump(trace::chromeTraceJson());
+    if (dump.names.size() > 256) {
+        std::cerr << "Error: " << dump.names.size() << " rings after " << threads << " threads" << std::endl;
+        return 1;
+    }
+    for (const auto& entry : dump.events) {
+        int reuse = 0;
+        for (const auto& event : entry.second) reuse += event.first == "reuse";
+        if (reuse > 1) {
+            std::cerr << "Error: reused ring still holds a previous thread's events" << std::endl;
+            return 1;
+        }
+    }
+    if (argsOf(dump, "short " + std::to_string(threads - 1), "reuse") != std::vector<uint64_t>{threads - 1} ||
+        argsOf(dump, "main", "wrap").size() != 4095) {
+        std::cerr << "Error: last thread's event or the live main ring lost on reuse" << std::endl;
+        return 1;
+    }
+
+    std::cout << "Test passed!" << std::endl;
+    return 0;
+}